@@ -0,0 +1,371 @@
+#include "BigInt.hpp"
+#include <algorithm>
+#include <limits>
+#include <stdexcept>
+
+BigInt::BigInt( std::int64_t value )
+    : m_negative{ value < 0 }
+{
+    // Negate in unsigned arithmetic so that INT64_MIN does not overflow
+    std::uint64_t magnitude{ value < 0 ? 0 - static_cast<std::uint64_t>( value ) : static_cast<std::uint64_t>( value ) };
+
+    while ( magnitude > 0 )
+    {
+        m_limbs.push_back( static_cast<std::uint32_t>( magnitude % BASE ) );
+        magnitude /= BASE;
+    }
+}
+
+BigInt::BigInt( std::string_view str )
+{
+    if ( !str.empty() && ( str[0] == '-' || str[0] == '+' ) )
+    {
+        m_negative = str[0] == '-';
+        str.remove_prefix( 1 );
+    }
+
+    if ( str.empty() || !std::all_of( str.begin(), str.end(), []( char c ) { return c >= '0' && c <= '9'; } ) )
+        throw std::invalid_argument( "BigInt: not a decimal integer" );
+
+    // Consume BASE_DIGITS digits at a time, starting from the least significant end
+    for ( std::size_t end{ str.size() }; end > 0; )
+    {
+        std::size_t   begin{ end > BASE_DIGITS ? end - BASE_DIGITS : 0 };
+        std::uint32_t limb{ 0 };
+        for ( std::size_t i{ begin }; i < end; ++i )
+            limb = limb * 10 + static_cast<std::uint32_t>( str[i] - '0' );
+        m_limbs.push_back( limb );
+        end = begin;
+    }
+
+    trim();
+}
+
+// Arithmetic
+
+BigInt BigInt::operator-() const
+{
+    BigInt result{ *this };
+    if ( !result.isZero() )
+        result.m_negative = !m_negative;
+    return result;
+}
+
+BigInt BigInt::operator+( const BigInt& other ) const
+{
+    BigInt result;
+
+    if ( m_negative == other.m_negative )
+    {
+        result.m_limbs    = addMagnitude( m_limbs, other.m_limbs );
+        result.m_negative = m_negative;
+    }
+    else if ( compareMagnitude( m_limbs, other.m_limbs ) >= 0 )
+    {
+        result.m_limbs    = subMagnitude( m_limbs, other.m_limbs );
+        result.m_negative = m_negative;
+    }
+    else
+    {
+        result.m_limbs    = subMagnitude( other.m_limbs, m_limbs );
+        result.m_negative = other.m_negative;
+    }
+
+    result.trim();
+    return result;
+}
+
+BigInt BigInt::operator-( const BigInt& other ) const
+{
+    return *this + ( -other );
+}
+
+BigInt BigInt::operator*( const BigInt& other ) const
+{
+    BigInt result;
+    result.m_limbs    = mulMagnitude( m_limbs, other.m_limbs );
+    result.m_negative = m_negative != other.m_negative;
+    result.trim();
+    return result;
+}
+
+BigInt BigInt::operator/( const BigInt& other ) const
+{
+    if ( other.isZero() )
+        throw std::domain_error( "BigInt: division by zero" );
+
+    BigInt quotient;
+    Limbs  remainder;
+    divModMagnitude( m_limbs, other.m_limbs, quotient.m_limbs, remainder );
+    quotient.m_negative = m_negative != other.m_negative;
+    quotient.trim();
+    return quotient;
+}
+
+BigInt BigInt::operator%( const BigInt& other ) const
+{
+    if ( other.isZero() )
+        throw std::domain_error( "BigInt: division by zero" );
+
+    // Sign of the remainder follows the dividend, like the built-in integer types
+    Limbs  quotient;
+    BigInt remainder;
+    divModMagnitude( m_limbs, other.m_limbs, quotient, remainder.m_limbs );
+    remainder.m_negative = m_negative;
+    remainder.trim();
+    return remainder;
+}
+
+// Comparison
+
+bool BigInt::operator==( const BigInt& other ) const
+{
+    return m_negative == other.m_negative && m_limbs == other.m_limbs;
+}
+
+bool BigInt::operator!=( const BigInt& other ) const
+{
+    return !( *this == other );
+}
+
+bool BigInt::operator<( const BigInt& other ) const
+{
+    if ( m_negative != other.m_negative )
+        return m_negative;
+
+    int cmp{ compareMagnitude( m_limbs, other.m_limbs ) };
+    return m_negative ? cmp > 0 : cmp < 0;
+}
+
+bool BigInt::operator>( const BigInt& other ) const
+{
+    return other < *this;
+}
+
+bool BigInt::operator<=( const BigInt& other ) const
+{
+    return !( other < *this );
+}
+
+bool BigInt::operator>=( const BigInt& other ) const
+{
+    return !( *this < other );
+}
+
+// Queries and conversions
+
+bool BigInt::isZero() const
+{
+    return m_limbs.empty();
+}
+
+bool BigInt::isNegative() const
+{
+    return m_negative;
+}
+
+bool BigInt::fitsInt64() const
+{
+    // 3 limbs already hold up to 10^27, far beyond 64 bits
+    if ( m_limbs.size() > 3 )
+        return false;
+
+    std::uint64_t magnitude{ 0 };
+    for ( auto it{ m_limbs.rbegin() }; it != m_limbs.rend(); ++it )
+    {
+        if ( __builtin_mul_overflow( magnitude, BASE, &magnitude ) ||
+             __builtin_add_overflow( magnitude, *it, &magnitude ) )
+            return false;
+    }
+
+    constexpr std::uint64_t max{ std::numeric_limits<std::int64_t>::max() };
+    return magnitude <= ( m_negative ? max + 1 : max );
+}
+
+std::int64_t BigInt::toInt64() const
+{
+    std::uint64_t magnitude{ 0 };
+    for ( auto it{ m_limbs.rbegin() }; it != m_limbs.rend(); ++it )
+        magnitude = magnitude * BASE + *it;
+
+    return static_cast<std::int64_t>( m_negative ? 0 - magnitude : magnitude );
+}
+
+std::size_t BigInt::digitCount() const
+{
+    if ( m_limbs.empty() )
+        return 1;
+
+    // Full limbs below the most significant one, which has no leading zeros
+    std::size_t count{ ( m_limbs.size() - 1 ) * BASE_DIGITS };
+    for ( std::uint32_t top{ m_limbs.back() }; top > 0; top /= 10 )
+        ++count;
+    return count;
+}
+
+std::string BigInt::toString() const
+{
+    if ( isZero() )
+        return "0";
+
+    std::string str{ m_negative ? "-" : "" };
+    str += std::to_string( m_limbs.back() );
+
+    // Every limb but the most significant one is zero-padded to BASE_DIGITS digits
+    for ( auto it{ m_limbs.rbegin() + 1 }; it != m_limbs.rend(); ++it )
+    {
+        std::string limb{ std::to_string( *it ) };
+        str.append( BASE_DIGITS - limb.size(), '0' );
+        str += limb;
+    }
+
+    return str;
+}
+
+std::ostream& operator<<( std::ostream& out, const BigInt& num )
+{
+    return out << num.toString();
+}
+
+// Private helpers
+
+// Remove leading zero limbs; zero is never negative
+void BigInt::trim()
+{
+    while ( !m_limbs.empty() && m_limbs.back() == 0 )
+        m_limbs.pop_back();
+
+    if ( m_limbs.empty() )
+        m_negative = false;
+}
+
+int BigInt::compareMagnitude( const Limbs& a, const Limbs& b )
+{
+    if ( a.size() != b.size() )
+        return a.size() < b.size() ? -1 : 1;
+
+    for ( std::size_t i{ a.size() }; i > 0; --i )
+    {
+        if ( a[i - 1] != b[i - 1] )
+            return a[i - 1] < b[i - 1] ? -1 : 1;
+    }
+
+    return 0;
+}
+
+BigInt::Limbs BigInt::addMagnitude( const Limbs& a, const Limbs& b )
+{
+    Limbs result;
+    result.reserve( std::max( a.size(), b.size() ) + 1 );
+
+    std::uint32_t carry{ 0 };
+    for ( std::size_t i{ 0 }; i < a.size() || i < b.size() || carry; ++i )
+    {
+        std::uint32_t sum{ carry };
+        if ( i < a.size() )
+            sum += a[i];
+        if ( i < b.size() )
+            sum += b[i];
+
+        carry = sum >= BASE;
+        result.push_back( carry ? sum - BASE : sum );
+    }
+
+    return result;
+}
+
+BigInt::Limbs BigInt::subMagnitude( const Limbs& a, const Limbs& b )
+{
+    Limbs result;
+    result.reserve( a.size() );
+
+    std::int64_t borrow{ 0 };
+    for ( std::size_t i{ 0 }; i < a.size(); ++i )
+    {
+        std::int64_t diff{ static_cast<std::int64_t>( a[i] ) - borrow - ( i < b.size() ? b[i] : 0 ) };
+
+        borrow = diff < 0;
+        result.push_back( static_cast<std::uint32_t>( borrow ? diff + BASE : diff ) );
+    }
+
+    while ( !result.empty() && result.back() == 0 )
+        result.pop_back();
+
+    return result;
+}
+
+BigInt::Limbs BigInt::mulMagnitude( const Limbs& a, const Limbs& b )
+{
+    if ( a.empty() || b.empty() )
+        return {};
+
+    std::vector<std::uint64_t> acc( a.size() + b.size(), 0 );
+
+    // Schoolbook multiplication; carry after every row so that acc never overflows
+    for ( std::size_t i{ 0 }; i < a.size(); ++i )
+    {
+        std::uint64_t carry{ 0 };
+        for ( std::size_t j{ 0 }; j < b.size(); ++j )
+        {
+            std::uint64_t cur{ acc[i + j] + static_cast<std::uint64_t>( a[i] ) * b[j] + carry };
+            acc[i + j] = cur % BASE;
+            carry      = cur / BASE;
+        }
+        acc[i + b.size()] += carry;
+    }
+
+    Limbs result( acc.begin(), acc.end() );
+    while ( !result.empty() && result.back() == 0 )
+        result.pop_back();
+
+    return result;
+}
+
+void BigInt::divModMagnitude( const Limbs& a, const Limbs& b, Limbs& quotient, Limbs& remainder )
+{
+    quotient.assign( a.size(), 0 );
+    remainder.clear();
+
+    // Short division when the divisor is a single limb
+    if ( b.size() == 1 )
+    {
+        std::uint64_t rem{ 0 };
+        for ( std::size_t i{ a.size() }; i > 0; --i )
+        {
+            std::uint64_t cur{ rem * BASE + a[i - 1] };
+            quotient[i - 1] = static_cast<std::uint32_t>( cur / b[0] );
+            rem             = cur % b[0];
+        }
+        if ( rem != 0 )
+            remainder.push_back( static_cast<std::uint32_t>( rem ) );
+    }
+    // Long division, finding each quotient limb by binary search
+    else
+    {
+        for ( std::size_t i{ a.size() }; i > 0; --i )
+        {
+            // remainder = remainder * BASE + a[i - 1]
+            remainder.insert( remainder.begin(), a[i - 1] );
+            while ( !remainder.empty() && remainder.back() == 0 )
+                remainder.pop_back();
+
+            std::uint32_t low{ 0 };
+            std::uint32_t high{ BASE - 1 };
+            while ( low < high )
+            {
+                std::uint32_t mid{ low + ( high - low + 1 ) / 2 };
+                if ( compareMagnitude( mulMagnitude( b, { mid } ), remainder ) <= 0 )
+                    low = mid;
+                else
+                    high = mid - 1;
+            }
+
+            quotient[i - 1] = low;
+            if ( low > 0 )
+                remainder = subMagnitude( remainder, mulMagnitude( b, { low } ) );
+        }
+    }
+
+    while ( !quotient.empty() && quotient.back() == 0 )
+        quotient.pop_back();
+}
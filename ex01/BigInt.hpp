@@ -0,0 +1,69 @@
+#ifndef BIGINT_HPP
+#define BIGINT_HPP
+
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Arbitrary-precision signed integer (sign and magnitude, base 10^9 limbs)
+// RPN only switches to it once 64-bit arithmetic overflows, so it favours simplicity over speed
+class BigInt
+{
+  public:
+    // OCF
+    BigInt()                                 = default;
+    BigInt( const BigInt& other )            = default;
+    BigInt& operator=( const BigInt& other ) = default;
+    ~BigInt()                                = default;
+
+    BigInt( std::int64_t value );
+    // Parse an optionally signed string of decimal digits; throw std::invalid_argument otherwise
+    explicit BigInt( std::string_view str );
+
+    // Arithmetic (division truncates toward zero, like the built-in integer types)
+    BigInt operator-() const;
+    BigInt operator+( const BigInt& other ) const;
+    BigInt operator-( const BigInt& other ) const;
+    BigInt operator*( const BigInt& other ) const;
+    BigInt operator/( const BigInt& other ) const;
+    BigInt operator%( const BigInt& other ) const;
+
+    // Comparison
+    bool operator==( const BigInt& other ) const;
+    bool operator!=( const BigInt& other ) const;
+    bool operator<( const BigInt& other ) const;
+    bool operator>( const BigInt& other ) const;
+    bool operator<=( const BigInt& other ) const;
+    bool operator>=( const BigInt& other ) const;
+
+    bool         isZero() const;
+    bool         isNegative() const;
+    bool         fitsInt64() const;
+    std::int64_t toInt64() const; // Only meaningful if fitsInt64()
+    std::string  toString() const;
+    std::size_t  digitCount() const; // Decimal digits of the magnitude (1 for zero)
+
+  private:
+    using Limbs = std::vector<std::uint32_t>;
+
+    static constexpr std::uint32_t BASE{ 1'000'000'000 };
+    static constexpr int           BASE_DIGITS{ 9 };
+
+    bool  m_negative{ false };
+    Limbs m_limbs{}; // Least significant limb first; empty means zero
+
+    void trim();
+
+    // Helpers that only look at magnitudes
+    static int   compareMagnitude( const Limbs& a, const Limbs& b );
+    static Limbs addMagnitude( const Limbs& a, const Limbs& b );
+    static Limbs subMagnitude( const Limbs& a, const Limbs& b ); // Requires |a| >= |b|
+    static Limbs mulMagnitude( const Limbs& a, const Limbs& b );
+    static void  divModMagnitude( const Limbs& a, const Limbs& b, Limbs& quotient, Limbs& remainder );
+};
+
+std::ostream& operator<<( std::ostream& out, const BigInt& num );
+
+#endif /* BIGINT_HPP */
@@ -0,0 +1,108 @@
+#include "ExpressionCache.hpp"
+#include <functional> // std::hash
+
+ExpressionCache::ExpressionCache( std::size_t capacity )
+    : m_capacity{ capacity }
+{
+}
+
+ExpressionCache::ProgramPtr ExpressionCache::find( std::string_view expression )
+{
+    std::size_t                 hash{ std::hash<std::string_view>{}( expression ) };
+    std::lock_guard<std::mutex> lock{ m_mutex };
+
+    auto it{ lookup( hash, expression ) };
+    if ( it == m_entries.end() )
+    {
+        ++m_misses;
+        return nullptr;
+    }
+
+    ++m_hits;
+    // Move to the front of the recency list (iterators stay valid)
+    m_entries.splice( m_entries.begin(), m_entries, it );
+    return it->program;
+}
+
+void ExpressionCache::insert( std::string_view expression, ProgramPtr program )
+{
+    if ( m_capacity == 0 || expression.length() > MAX_EXPRESSION_LENGTH )
+        return;
+
+    std::size_t                 hash{ std::hash<std::string_view>{}( expression ) };
+    std::lock_guard<std::mutex> lock{ m_mutex };
+
+    // Another thread may have compiled the same expression in the meantime
+    auto it{ lookup( hash, expression ) };
+    if ( it != m_entries.end() )
+    {
+        it->program = std::move( program );
+        m_entries.splice( m_entries.begin(), m_entries, it );
+        return;
+    }
+
+    // Evict the least recently used entry
+    if ( m_entries.size() >= m_capacity )
+    {
+        auto last{ std::prev( m_entries.end() ) };
+        auto range{ m_index.equal_range( last->hash ) };
+        for ( auto index_it{ range.first }; index_it != range.second; ++index_it )
+        {
+            if ( index_it->second == last )
+            {
+                m_index.erase( index_it );
+                break;
+            }
+        }
+        m_entries.pop_back();
+    }
+
+    m_entries.push_front( { hash, std::string{ expression }, std::move( program ) } );
+    m_index.emplace( hash, m_entries.begin() );
+}
+
+void ExpressionCache::clear()
+{
+    std::lock_guard<std::mutex> lock{ m_mutex };
+
+    m_entries.clear();
+    m_index.clear();
+    m_hits   = 0;
+    m_misses = 0;
+}
+
+std::size_t ExpressionCache::hits() const
+{
+    std::lock_guard<std::mutex> lock{ m_mutex };
+    return m_hits;
+}
+
+std::size_t ExpressionCache::misses() const
+{
+    std::lock_guard<std::mutex> lock{ m_mutex };
+    return m_misses;
+}
+
+std::size_t ExpressionCache::size() const
+{
+    std::lock_guard<std::mutex> lock{ m_mutex };
+    return m_entries.size();
+}
+
+std::size_t ExpressionCache::capacity() const
+{
+    return m_capacity;
+}
+
+ExpressionCache::EntryList::iterator ExpressionCache::lookup( std::size_t hash, std::string_view expression )
+{
+    auto range{ m_index.equal_range( hash ) };
+    for ( auto it{ range.first }; it != range.second; ++it )
+    {
+        // Same hash is not enough, the text has to match as well
+        if ( it->second->expression == expression )
+            return it->second;
+    }
+
+    return m_entries.end();
+}
@@ -0,0 +1,62 @@
+#ifndef EXPRESSIONCACHE_HPP
+#define EXPRESSIONCACHE_HPP
+
+#include "RPN.hpp"
+#include <cstddef>
+#include <list>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <unordered_map>
+
+// Bounded, thread-safe LRU cache of compiled RPN programs keyed by expression text
+// Entries are found by hash and confirmed by a full comparison of the text
+class ExpressionCache
+{
+  public:
+    using ProgramPtr = std::shared_ptr<const RPN::Program>;
+
+    static constexpr std::size_t DEFAULT_CAPACITY{ 8192 };
+    // Longer expressions are rare and would make the cache's memory use unbounded
+    static constexpr std::size_t MAX_EXPRESSION_LENGTH{ 4096 };
+
+    // OCF (the cache owns a mutex, so it cannot be copied)
+    explicit ExpressionCache( std::size_t capacity = DEFAULT_CAPACITY );
+    ExpressionCache( const ExpressionCache& other )            = delete;
+    ExpressionCache& operator=( const ExpressionCache& other ) = delete;
+    ~ExpressionCache()                                         = default;
+
+    // Return the cached program (marking it most recently used), or nullptr on a miss
+    ProgramPtr find( std::string_view expression );
+    // Add or replace an entry, evicting the least recently used one if the cache is full
+    void insert( std::string_view expression, ProgramPtr program );
+    void clear();
+
+    std::size_t hits() const;
+    std::size_t misses() const;
+    std::size_t size() const;
+    std::size_t capacity() const;
+
+  private:
+    struct Entry
+    {
+        std::size_t hash;
+        std::string expression;
+        ProgramPtr  program;
+    };
+
+    using EntryList = std::list<Entry>; // Most recently used first
+
+    mutable std::mutex                                        m_mutex;
+    std::size_t                                               m_capacity;
+    std::size_t                                               m_hits{ 0 };
+    std::size_t                                               m_misses{ 0 };
+    EntryList                                                 m_entries;
+    std::unordered_multimap<std::size_t, EntryList::iterator> m_index;
+
+    // Locate an entry; the caller must hold the lock
+    EntryList::iterator lookup( std::size_t hash, std::string_view expression );
+};
+
+#endif /* EXPRESSIONCACHE_HPP */
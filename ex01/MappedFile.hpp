@@ -0,0 +1,41 @@
+#ifndef MAPPEDFILE_HPP
+#define MAPPEDFILE_HPP
+
+#include <cstddef>
+#include <exception>
+#include <string>
+#include <string_view>
+
+// Read-only memory mapping of a whole file (RAII), so that huge inputs are never copied
+// Pipes, FIFOs and terminals cannot be mapped: they are read into memory instead
+class MappedFile
+{
+  public:
+    // OCF (a mapping has a single owner, so it cannot be copied)
+    explicit MappedFile( const std::string& path );
+    MappedFile( const MappedFile& other )            = delete;
+    MappedFile& operator=( const MappedFile& other ) = delete;
+    ~MappedFile();
+
+    std::string_view view() const;
+
+    // Exception class
+    class FileError : public std::exception
+    {
+      public:
+        FileError( std::string_view error );
+        const char* what() const noexcept override;
+
+      private:
+        const std::string m_error{};
+    };
+
+  private:
+    void readAll( int fd, const std::string& path );
+
+    const char* m_data{ nullptr };
+    std::size_t m_size{ 0 };
+    std::string m_contents{}; // What was read from a file that is not a regular file
+};
+
+#endif /* MAPPEDFILE_HPP */
@@ -1,4 +1,10 @@
 #include "RPN.hpp"
+#include "ExpressionCache.hpp"
+#include "WorkStealingPool.hpp"
+#include <algorithm>
+#include <charconv> // std::from_chars
+#include <limits>
+#include <memory>
 
 RPN::RPN()
 {
@@ -6,13 +12,21 @@ RPN::RPN()
 
 RPN::RPN( const RPN& other )
     : m_nums{ other.m_nums }
+    , m_depth{ other.m_depth }
+    , m_big_nums{ other.m_big_nums }
+    , m_promoted{ other.m_promoted }
 {
 }
 
 RPN& RPN::operator=( const RPN& other )
 {
     if ( this != &other )
-        m_nums = other.m_nums;
+    {
+        m_nums     = other.m_nums;
+        m_depth    = other.m_depth;
+        m_big_nums = other.m_big_nums;
+        m_promoted = other.m_promoted;
+    }
 
     return *this;
 }
@@ -21,122 +35,589 @@ RPN::~RPN()
 {
 }
 
-int performOperation( int first, int second, char operator_char )
+// Powers are computed with schoolbook multiplication, whose cost grows with the square of the result size, so
+// capping the estimated size of the result keeps a single power to a bounded amount of work
+constexpr std::int64_t MAX_POWER_DIGITS{ 100'000 };
+
+std::string divisionByZeroMessage( const std::string& first, const std::string& second, char operator_char )
+{
+    return "Cannot perform division by zero: " + first + operator_char + second;
+}
+
+// Power with the truncation of integer division: a negative exponent gives 0 unless |base| is 1
+// Return false (leaving result unspecified) on overflow
+bool powInt64( std::int64_t base, std::int64_t exponent, std::int64_t& result )
 {
-    if ( operator_char == '+' )
+    if ( exponent < 0 )
+    {
+        if ( base == 0 )
+            throw RPN::DivisionByZero(
+                divisionByZeroMessage( std::to_string( base ), std::to_string( exponent ), '^' ) );
+        result = base == 1 ? 1 : base == -1 ? ( exponent % 2 == 0 ? 1 : -1 ) : 0;
+        return true;
+    }
+
+    // Square and multiply
+    result = 1;
+    while ( exponent > 0 )
+    {
+        if ( ( exponent & 1 ) && __builtin_mul_overflow( result, base, &result ) )
+            return false;
+        exponent >>= 1;
+        if ( exponent > 0 && __builtin_mul_overflow( base, base, &base ) )
+            return false;
+    }
+
+    return true;
+}
+
+BigInt powBig( BigInt base, BigInt exponent )
+{
+    const BigInt one{ 1 };
+    const BigInt minus_one{ -1 };
+    const BigInt two{ 2 };
+
+    // Same results as powInt64() for the bases whose powers never grow
+    if ( exponent.isNegative() && base.isZero() )
+        throw RPN::DivisionByZero( divisionByZeroMessage( base.toString(), exponent.toString(), '^' ) );
+    if ( base == one || ( base.isZero() && !exponent.isZero() ) )
+        return base;
+    if ( base == minus_one )
+        return ( exponent % two ).isZero() ? one : minus_one;
+    if ( exponent.isNegative() )
+        return 0;
+
+    // The result has at most ( digits of base ) * exponent digits
+    auto base_digits{ static_cast<std::int64_t>( base.digitCount() ) };
+    if ( !exponent.fitsInt64() || exponent.toInt64() > MAX_POWER_DIGITS / base_digits )
+        throw RPN::InvalidExpression( "Result of power is too large: " + base.toString() + '^' + exponent.toString() );
+
+    // Square and multiply
+    BigInt       result{ one };
+    std::int64_t exp{ exponent.toInt64() };
+    while ( exp > 0 )
+    {
+        if ( exp & 1 )
+            result = result * base;
+        exp >>= 1;
+        if ( exp > 0 )
+            base = base * base;
+    }
+
+    return result;
+}
+
+// Arbitrary-precision binary operations, used once an evaluation has been promoted
+BigInt performOperation( const BigInt& first, const BigInt& second, RPN::OpCode op )
+{
+    switch ( op )
+    {
+    case RPN::OpCode::Add:
         return first + second;
-    if ( operator_char == '-' )
+    case RPN::OpCode::Sub:
         return first - second;
-    if ( operator_char == '*' )
+    case RPN::OpCode::Mul:
         return first * second;
-    if ( operator_char == '/' )
-    {
-        if ( second == 0 )
-            throw RPN::DivisionByZero( "Cannot perform division by zero: " + std::to_string( first ) + '/' +
-                                       std::to_string( second ) );
+    case RPN::OpCode::Div:
+        if ( second.isZero() )
+            throw RPN::DivisionByZero( divisionByZeroMessage( first.toString(), second.toString(), '/' ) );
         return first / second;
+    case RPN::OpCode::Mod:
+        if ( second.isZero() )
+            throw RPN::DivisionByZero( divisionByZeroMessage( first.toString(), second.toString(), '%' ) );
+        return first % second;
+    case RPN::OpCode::Pow:
+        return powBig( first, second );
+    case RPN::OpCode::Min:
+        return std::min( first, second );
+    case RPN::OpCode::Max:
+        return std::max( first, second );
+    default:
+        // Should never be reached but just in case
+        throw RPN::InvalidExpression( "Operator is not valid" );
+    }
+}
+
+// Push a value computed elsewhere, keeping to the 64-bit stack while possible
+void RPN::pushValue( const BigInt& value )
+{
+    if ( !m_promoted && value.fitsInt64() )
+    {
+        if ( m_nums.size() <= m_depth )
+            m_nums.resize( m_depth + 1 );
+        m_nums[m_depth++] = value.toInt64();
+    }
+    else
+    {
+        promote();
+        m_big_nums.push_back( value );
     }
-    // Should never be reached but just in case
-    throw RPN::InvalidExpression( "Operator is not valid" );
 }
 
-// #include <iostream>
-// #include <vector>
-// #include <algorithm>
-// void printStack( std::stack<int> stack )
-// {
-//     std::vector<int> vec;
-//     vec.reserve(stack.size());
+// Move every 64-bit number onto the BigInt stack (keeping their order); later work is done in BigInt
+void RPN::promote()
+{
+    if ( m_promoted )
+        return;
+
+    m_big_nums.reserve( m_big_nums.size() + m_depth );
+    for ( std::size_t i{ 0 }; i < m_depth; ++i )
+        m_big_nums.emplace_back( m_nums[i] );
+
+    m_depth    = 0;
+    m_promoted = true;
+}
 
-//     for (auto i {stack.size()}; i > 0; --i)
-//     {
-//         vec.push_back(stack.top());
-//         stack.pop();
-//     }
+RPN::Program RPN::compile( std::string_view expression )
+{
+    Program      program;
+    CompileState state;
 
-//     std::reverse(vec.begin(), vec.end());
+    compileChunk( expression, state, program, std::numeric_limits<std::size_t>::max() );
 
-//     std::cout << "{ ";
-//     for ( const auto& elem : vec )
-//         std::cout << elem << ' ';
-//     std::cout << "}\n";
-// }
+    return program;
+}
 
-int RPN::evaluate( const std::string& expression )
+// Lex and validate up to max_instructions instructions, appending them to program
+// Return true once the expression is exhausted or found to be invalid (program.error is then set)
+bool RPN::compileChunk( std::string_view expression, CompileState& state, Program& program,
+                        std::size_t max_instructions )
 {
-    std::string cur_expression{ expression };
+    std::size_t pos{ state.pos };
+    std::size_t emitted{ 0 };
 
-    while ( true )
+    // Skip whitespace
+    while ( pos < expression.length() && isSpace( expression[pos] ) )
+        ++pos;
+
+    while ( pos < expression.length() )
     {
-        std::size_t remaining_pos{ 0 };
-        try
+        if ( emitted == max_instructions )
         {
-            m_nums.push( std::stoi( cur_expression, &remaining_pos ) );
+            state.pos = pos;
+            return false;
+        }
 
-            // Erase used number and trailing whitespace
-            while ( remaining_pos < cur_expression.length() && isSpace( cur_expression[remaining_pos] ) )
-                ++remaining_pos;
-            cur_expression.erase( 0, remaining_pos );
+        std::size_t end{ numberEnd( expression, pos ) };
+
+        if ( end != pos )
+        {
+            // from_chars does not accept an explicit plus sign
+            std::size_t  digits_begin{ expression[pos] == '+' ? pos + 1 : pos };
+            std::int64_t num;
+            auto [ptr, ec]{ std::from_chars( expression.data() + digits_begin, expression.data() + end, num ) };
+            (void)ptr;
 
-            // Exit loop if expression string is exhausted
-            if ( cur_expression.empty() )
-                break;
+            if ( ec == std::errc() )
+                program.instructions.push_back( { OpCode::Push, num } );
+            else
+            {
+                // Literal does not fit in 64 bits
+                program.big_literals.emplace_back( expression.substr( pos, end - pos ) );
+                program.instructions.push_back(
+                    { OpCode::PushBig, static_cast<std::int64_t>( program.big_literals.size() - 1 ) } );
+            }
+            ++state.depth;
         }
-        catch ( const std::exception& )
+        else
         {
-            // Skip whitespace
-            while ( remaining_pos < cur_expression.length() && isSpace( cur_expression[remaining_pos] ) )
-                ++remaining_pos;
+            // Operators are either a single symbol or a word
+            end = pos + 1;
+            if ( isLetter( expression[pos] ) )
+            {
+                while ( end < expression.length() && isLetter( expression[end] ) )
+                    ++end;
+            }
 
-            // if a valid operator is present, evaluate and replace stack
-            if ( remaining_pos < cur_expression.length() && isOperator( cur_expression[remaining_pos] ) )
+            const OperatorInfo* info{ findOperator( expression.substr( pos, end - pos ) ) };
+            if ( !info )
             {
-                // Stack must have at least two numbers to perform any operation
-                if ( m_nums.size() < 2 )
-                    throw InvalidExpression(
-                        "Invalid expression (operation cannot be performed on fewer than 2 numbers): " + expression );
-
-                // Get the last 2 numbers in the stack to perform operation on
-                int second{ m_nums.top() };
-                m_nums.pop();
-                int first{ m_nums.top() };
-                m_nums.pop();
-
-                // Perform operation
-                m_nums.push( performOperation( first, second, cur_expression[remaining_pos] ) );
-
-                // Erase used operator and trailing whitespace
-                ++remaining_pos;
-                while ( remaining_pos < cur_expression.length() && isSpace( cur_expression[remaining_pos] ) )
-                    ++remaining_pos;
-                cur_expression.erase( 0, remaining_pos );
-
-                // Exit loop if expression string is exhausted
-                if ( cur_expression.empty() )
-                    break;
+                program.error =
+                    "Invalid expression (unknown operator / element found): " + describeExpression( expression );
+                return true;
             }
-            else if ( remaining_pos == cur_expression.length() )
-                break;
-            else
-                throw InvalidExpression( "Invalid expression (unknown operator / element found): " + expression );
+
+            // Stack must hold every operand of the operation
+            if ( state.depth < info->pops )
+            {
+                program.error = "Invalid expression (operation cannot be performed on fewer than " +
+                                std::to_string( info->pops ) + ( info->pops == 1 ? " number): " : " numbers): " ) +
+                                describeExpression( expression );
+                return true;
+            }
+
+            program.instructions.push_back( { info->op, 0 } );
+            state.depth = state.depth - info->pops + info->pushes;
         }
+        ++emitted;
+
+        if ( state.depth > state.max_depth )
+        {
+            state.max_depth   = state.depth;
+            program.max_depth = state.depth;
+        }
+
+        // Skip used number / operator and trailing whitespace
+        pos = end;
+        while ( pos < expression.length() && isSpace( expression[pos] ) )
+            ++pos;
     }
 
-    // Nothing should be remaining in the cur_expression
-    if ( !cur_expression.empty() )
-        throw InvalidExpression( "Expression could not be evaluated. " + expression );
+    state.pos = pos;
 
     // Stack size should be 1, otherwise the expression is invalid
-    if ( m_nums.size() != 1 )
-        throw InvalidExpression( "Invalid expression (incorrect number of operators): " + expression );
+    if ( state.depth != 1 )
+        program.error = "Invalid expression (incorrect number of operators): " + describeExpression( expression );
+
+    return true;
+}
+
+// Start from a clean state, a previous evaluation may have thrown midway
+void RPN::reset()
+{
+    m_depth = 0;
+    m_big_nums.clear();
+    m_promoted = false;
+}
+
+// Execute instructions [begin, end) on the current stacks
+// (stack sizes have already been validated by compileChunk())
+void RPN::run( const Program& program, std::size_t begin, std::size_t end )
+{
+    if ( !m_promoted )
+        begin = runFast( program, begin, end );
+
+    // The fast path stopped early: this evaluation continues in arbitrary precision
+    if ( begin < end )
+    {
+        promote();
+        runBig( program, begin, end );
+    }
+}
+
+// Threaded interpreter over 64-bit numbers; return the index of the first instruction that needs
+// arbitrary precision (an overflow or a big literal), or end
+std::size_t RPN::runFast( const Program& program, std::size_t begin, std::size_t end )
+{
+    // Handlers indexed by OpCode (computed goto, supported by GCC and Clang): every handler jumps
+    // straight to the next one, so each operator costs one indirect branch however many there are
+    static const void* const handlers[]{
+        &&op_push, &&op_push_big, &&op_add, &&op_sub, &&op_mul, &&op_div, &&op_mod,
+        &&op_pow,  &&op_min,      &&op_max, &&op_neg, &&op_dup, &&op_swap,
+    };
+    static_assert( sizeof( handlers ) / sizeof( handlers[0] ) == static_cast<std::size_t>( OpCode::Count ),
+                   "every OpCode needs a handler" );
+
+    if ( m_nums.size() < program.max_depth )
+        m_nums.resize( program.max_depth );
+
+    const Instruction*       ip{ program.instructions.data() + begin };
+    const Instruction* const last{ program.instructions.data() + end };
+    std::int64_t*            sp{ m_nums.data() + m_depth }; // One past the top of the stack
+    std::int64_t             result;
+
+#define DISPATCH()                                                                                                     \
+    do                                                                                                                 \
+    {                                                                                                                  \
+        if ( ip == last )                                                                                              \
+            goto done;                                                                                                 \
+        goto* handlers[static_cast<std::size_t>( ip->op )];                                                            \
+    } while ( 0 )
+
+// Replace the top 2 numbers with result
+#define POP2_PUSH_RESULT()                                                                                             \
+    sp[-2] = result;                                                                                                   \
+    --sp;                                                                                                              \
+    ++ip;                                                                                                              \
+    DISPATCH()
+
+    DISPATCH();
+
+op_push:
+    *sp++ = ip++->value;
+    DISPATCH();
+op_push_big:
+    goto done;
+op_add:
+    if ( __builtin_add_overflow( sp[-2], sp[-1], &result ) )
+        goto done;
+    POP2_PUSH_RESULT();
+op_sub:
+    if ( __builtin_sub_overflow( sp[-2], sp[-1], &result ) )
+        goto done;
+    POP2_PUSH_RESULT();
+op_mul:
+    if ( __builtin_mul_overflow( sp[-2], sp[-1], &result ) )
+        goto done;
+    POP2_PUSH_RESULT();
+op_div:
+    if ( sp[-1] == 0 )
+        throw DivisionByZero( divisionByZeroMessage( std::to_string( sp[-2] ), std::to_string( sp[-1] ), '/' ) );
+    // The only quotient that does not fit: INT64_MIN / -1
+    if ( sp[-1] == -1 && sp[-2] == std::numeric_limits<std::int64_t>::min() )
+        goto done;
+    result = sp[-2] / sp[-1];
+    POP2_PUSH_RESULT();
+op_mod:
+    if ( sp[-1] == 0 )
+        throw DivisionByZero( divisionByZeroMessage( std::to_string( sp[-2] ), std::to_string( sp[-1] ), '%' ) );
+    // INT64_MIN % -1 is undefined behaviour even though the remainder is 0
+    result = sp[-1] == -1 ? 0 : sp[-2] % sp[-1];
+    POP2_PUSH_RESULT();
+op_pow:
+    if ( !powInt64( sp[-2], sp[-1], result ) )
+        goto done;
+    POP2_PUSH_RESULT();
+op_min:
+    result = std::min( sp[-2], sp[-1] );
+    POP2_PUSH_RESULT();
+op_max:
+    result = std::max( sp[-2], sp[-1] );
+    POP2_PUSH_RESULT();
+op_neg:
+    if ( sp[-1] == std::numeric_limits<std::int64_t>::min() )
+        goto done;
+    sp[-1] = -sp[-1];
+    ++ip;
+    DISPATCH();
+op_dup:
+    sp[0] = sp[-1];
+    ++sp;
+    ++ip;
+    DISPATCH();
+op_swap:
+    std::swap( sp[-1], sp[-2] );
+    ++ip;
+    DISPATCH();
+
+#undef POP2_PUSH_RESULT
+#undef DISPATCH
+
+done:
+    m_depth = static_cast<std::size_t>( sp - m_nums.data() );
+    return static_cast<std::size_t>( ip - program.instructions.data() );
+}
+
+// Arbitrary-precision counterpart of runFast(), once the evaluation has been promoted
+void RPN::runBig( const Program& program, std::size_t begin, std::size_t end )
+{
+    for ( std::size_t i{ begin }; i < end; ++i )
+    {
+        const auto& instruction{ program.instructions[i] };
+
+        switch ( instruction.op )
+        {
+        case OpCode::Push:
+            m_big_nums.emplace_back( instruction.value );
+            break;
+        case OpCode::PushBig:
+            m_big_nums.push_back( program.big_literals[static_cast<std::size_t>( instruction.value )] );
+            break;
+        case OpCode::Neg:
+            m_big_nums.back() = -m_big_nums.back();
+            break;
+        case OpCode::Dup:
+        {
+            BigInt top{ m_big_nums.back() };
+            m_big_nums.push_back( std::move( top ) );
+            break;
+        }
+        case OpCode::Swap:
+            std::swap( m_big_nums[m_big_nums.size() - 1], m_big_nums[m_big_nums.size() - 2] );
+            break;
+        default:
+        {
+            // Binary operators: replace the top 2 numbers with the result
+            BigInt second{ std::move( m_big_nums.back() ) };
+            m_big_nums.pop_back();
+            m_big_nums.back() = performOperation( m_big_nums.back(), second, instruction.op );
+            break;
+        }
+        }
+    }
+}
+
+// Report a pending error or pop the result once the last instructions have run
+BigInt RPN::finish( const Program& program )
+{
+    if ( !program.error.empty() )
+        throw InvalidExpression( program.error );
 
     // Remaining number in the stack is our result
-    int result{ m_nums.top() };
-    m_nums.pop();
+    if ( !m_promoted )
+        return m_nums[--m_depth];
 
+    BigInt result{ std::move( m_big_nums.back() ) };
+    m_big_nums.pop_back();
     return result;
 }
 
+BigInt RPN::execute( const Program& program )
+{
+    reset();
+    run( program, 0, program.instructions.size() );
+    return finish( program );
+}
+
+BigInt RPN::evaluateStream( std::string_view expression )
+{
+    reset();
+
+    Program      chunk;
+    CompileState state;
+    chunk.instructions.reserve( STREAM_CHUNK_SIZE );
+
+    while ( true )
+    {
+        chunk.instructions.clear();
+        chunk.big_literals.clear();
+
+        bool done{ compileChunk( expression, state, chunk, STREAM_CHUNK_SIZE ) };
+        run( chunk, 0, chunk.instructions.size() );
+
+        if ( done )
+            return finish( chunk );
+    }
+}
+
+BigInt RPN::evaluate( const std::string& expression )
+{
+    return execute( *compileCached( expression ) );
+}
+
+BigInt RPN::evaluateParallel( const std::string& expression, WorkStealingPool& pool )
+{
+    return executeParallel( *compileCached( expression ), pool );
+}
+
+// Result (or first error) of one subtree evaluated on the pool
+struct SubtreeResult
+{
+    BigInt             value;
+    std::exception_ptr error;
+};
+
+BigInt RPN::executeParallel( const Program& program, WorkStealingPool& pool )
+{
+    const auto& code{ program.instructions };
+
+    // Invalid programs have to report their errors in order; small ones are not worth splitting
+    if ( !program.error.empty() || code.size() < PARALLEL_THRESHOLD )
+        return execute( program );
+
+    // Operand count of every opcode; dup and swap produce 2 values, so programs using them are not trees
+    int arity[static_cast<std::size_t>( OpCode::Count )]{};
+    for ( const auto& info : OPERATORS )
+        arity[static_cast<std::size_t>( info.op )] = info.pushes == 1 ? info.pops : -1;
+
+    // Every subtree is a contiguous range of the postfix program ending with its root:
+    // subtree_begin[i] is the first instruction of the subtree rooted at instruction i
+    // (the last operand of an operator ends just before it, each other one just before the next)
+    std::vector<std::size_t> subtree_begin( code.size() );
+    for ( std::size_t i{ 0 }; i < code.size(); ++i )
+    {
+        int operands{ arity[static_cast<std::size_t>( code[i].op )] };
+        if ( operands < 0 )
+            return execute( program );
+
+        std::size_t begin{ i };
+        for ( int k{ 0 }; k < operands; ++k )
+            begin = subtree_begin[begin - 1];
+        subtree_begin[i] = begin;
+    }
+
+    // Split from the root down until subtrees are at most grain instructions long; those that are
+    // still big enough become tasks (iterative, as a lopsided tree can be millions of levels deep)
+    std::size_t              grain{ std::max( MIN_GRAIN, code.size() / ( ( pool.size() + 1 ) * 8 ) ) };
+    std::vector<std::size_t> task_roots;
+    std::vector<std::size_t> to_split{ code.size() - 1 };
+
+    while ( !to_split.empty() )
+    {
+        std::size_t root{ to_split.back() };
+        to_split.pop_back();
+        std::size_t size{ root - subtree_begin[root] + 1 };
+
+        if ( size <= grain )
+        {
+            if ( size >= MIN_GRAIN / 4 )
+                task_roots.push_back( root );
+        }
+        else
+        {
+            // Operands, from last to first
+            std::size_t operand_root{ root - 1 };
+            for ( int k{ 0 }; k < arity[static_cast<std::size_t>( code[root].op )]; ++k )
+            {
+                to_split.push_back( operand_root );
+                operand_root = subtree_begin[operand_root] - 1;
+            }
+        }
+    }
+
+    std::sort( task_roots.begin(), task_roots.end() );
+
+    // Evaluate the tasks, each serially on its own stacks
+    std::vector<SubtreeResult> results( task_roots.size() );
+    for ( std::size_t t{ 0 }; t < task_roots.size(); ++t )
+    {
+        pool.submit( [&program, &subtree_begin, &task_roots, &results, t]() {
+            try
+            {
+                RPN rpn;
+                rpn.run( program, subtree_begin[task_roots[t]], task_roots[t] + 1 );
+                results[t].value = rpn.finish( program );
+            }
+            catch ( ... )
+            {
+                results[t].error = std::current_exception();
+            }
+        } );
+    }
+    pool.wait();
+
+    // Run the rest of the program serially, substituting the results of the tasks; an error is only
+    // reported when its subtree is reached, which makes it the same first error as in evaluate()
+    reset();
+    std::size_t pos{ 0 };
+    for ( std::size_t t{ 0 }; t < task_roots.size(); ++t )
+    {
+        run( program, pos, subtree_begin[task_roots[t]] );
+
+        if ( results[t].error )
+            std::rethrow_exception( results[t].error );
+        pushValue( results[t].value );
+
+        pos = task_roots[t] + 1;
+    }
+    run( program, pos, code.size() );
+
+    return finish( program );
+}
+
+std::shared_ptr<const RPN::Program> RPN::compileCached( const std::string& expression )
+{
+    ExpressionCache& expression_cache{ cache() };
+
+    // Repeated expressions skip lexing and validation entirely
+    if ( auto program{ expression_cache.find( expression ) } )
+        return program;
+
+    auto program{ std::make_shared<const Program>( compile( expression ) ) };
+
+    // Only valid programs are worth keeping
+    if ( program->error.empty() )
+        expression_cache.insert( expression, program );
+
+    return program;
+}
+
+ExpressionCache& RPN::cache()
+{
+    static ExpressionCache expression_cache;
+    return expression_cache;
+}
+
 // Exception classes
 
 RPN::DivisionByZero::DivisionByZero( std::string_view error )
@@ -161,12 +642,55 @@ const char* RPN::InvalidExpression::what() const noexcept
 
 // Helper functions
 
+// Look up an operator by its spelling; nullptr if there is none
+const RPN::OperatorInfo* findOperator( std::string_view name )
+{
+    for ( const auto& info : RPN::OPERATORS )
+    {
+        if ( info.name == name )
+            return &info;
+    }
+
+    return nullptr;
+}
+
 bool isOperator( const char c )
 {
-    return ( c == '+' || c == '-' || c == '*' || c == '/' );
+    return findOperator( std::string_view{ &c, 1 } ) != nullptr;
+}
+
+bool isLetter( const char c )
+{
+    return ( c >= 'a' && c <= 'z' ) || ( c >= 'A' && c <= 'Z' );
 }
 
 bool isSpace( const char c )
 {
     return ( c == ' ' || c == '\n' || c == '\t' || c == '\v' || c == '\r' || c == '\f' );
 }
+
+// Index one past an optionally signed run of digits starting at pos (pos itself if there is none)
+std::size_t numberEnd( std::string_view str, std::size_t pos )
+{
+    std::size_t end{ pos };
+    if ( end < str.length() && ( str[end] == '+' || str[end] == '-' ) )
+        ++end;
+
+    std::size_t digits_begin{ end };
+    while ( end < str.length() && str[end] >= '0' && str[end] <= '9' )
+        ++end;
+
+    return end == digits_begin ? pos : end;
+}
+
+// Expression text for error messages, shortened so that huge (e.g. memory-mapped) inputs stay readable
+std::string describeExpression( std::string_view expression )
+{
+    constexpr std::size_t max_length{ 100 };
+
+    if ( expression.length() <= max_length )
+        return std::string{ expression };
+
+    return std::string{ expression.substr( 0, max_length ) } + "... (" + std::to_string( expression.length() ) +
+           " bytes)";
+}
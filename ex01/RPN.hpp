@@ -1,9 +1,16 @@
 #ifndef RPN_HPP
 #define RPN_HPP
 
+#include "BigInt.hpp"
+#include <cstdint>
 #include <exception>
-#include <stack>
+#include <memory>
 #include <string>
+#include <string_view>
+#include <vector>
+
+class ExpressionCache;
+class WorkStealingPool;
 
 class RPN
 {
@@ -14,8 +21,76 @@ class RPN
     RPN& operator=( const RPN& other );
     ~RPN();
 
-    // Key member function
-    int evaluate( const std::string& expression );
+    // Every instruction; the order matches the dispatch tables in RPN.cpp
+    enum class OpCode : std::uint8_t
+    {
+        Push,
+        PushBig, // value is an index into Program::big_literals
+        Add,
+        Sub,
+        Mul,
+        Div,
+        Mod,
+        Pow,
+        Min,
+        Max,
+        Neg,
+        Dup,
+        Swap,
+        Count,
+    };
+
+    // How an operator is written and what it does to the stack
+    struct OperatorInfo
+    {
+        std::string_view name;
+        OpCode           op;
+        std::uint8_t     pops;
+        std::uint8_t     pushes;
+    };
+
+    // Adding an operator takes an OpCode, a row here and a handler in runFast() and runBig()
+    static constexpr OperatorInfo OPERATORS[]{
+        { "+", OpCode::Add, 2, 1 },     { "-", OpCode::Sub, 2, 1 },     { "*", OpCode::Mul, 2, 1 },
+        { "/", OpCode::Div, 2, 1 },     { "%", OpCode::Mod, 2, 1 },     { "^", OpCode::Pow, 2, 1 },
+        { "min", OpCode::Min, 2, 1 },   { "max", OpCode::Max, 2, 1 },   { "neg", OpCode::Neg, 1, 1 },
+        { "dup", OpCode::Dup, 1, 2 },   { "swap", OpCode::Swap, 2, 2 },
+    };
+
+    // One step of a compiled expression
+    struct Instruction
+    {
+        OpCode       op;
+        std::int64_t value; // Only used by the push instructions
+    };
+
+    // Lexed and validated form of an expression
+    struct Program
+    {
+        std::vector<Instruction> instructions;
+        std::vector<BigInt>      big_literals;
+        std::size_t              max_depth{ 0 }; // Deepest the stack gets, so it can be sized up front
+        // Set if the expression is invalid: instructions then stop where the error was found,
+        // so that executing them reports errors in the same order as a left to right evaluation
+        std::string error;
+    };
+
+    // Key member functions
+    // Evaluation runs on 64-bit integers and is promoted to BigInt only if it overflows
+    BigInt evaluate( const std::string& expression );
+    BigInt execute( const Program& program );
+    // Lex and execute a chunk of instructions at a time, so that memory is bounded by the
+    // stack depth rather than the length of the expression (used for memory-mapped files)
+    BigInt evaluateStream( std::string_view expression );
+    // Evaluate independent subtrees of a large expression on the pool; the result, and the first
+    // error reported, are the same as with evaluate()
+    BigInt evaluateParallel( const std::string& expression, WorkStealingPool& pool );
+    BigInt executeParallel( const Program& program, WorkStealingPool& pool );
+
+    static Program compile( std::string_view expression );
+
+    // Compiled programs shared by every RPN object, keyed by expression text
+    static ExpressionCache& cache();
 
     // Exception classes
 
@@ -40,11 +115,45 @@ class RPN
     };
 
   private:
-    std::stack<int> m_nums;
+    // Where compileChunk() stopped, so that lexing can resume with the next chunk
+    struct CompileState
+    {
+        std::size_t pos{ 0 };
+        std::size_t depth{ 0 };
+        std::size_t max_depth{ 0 };
+    };
+
+    static constexpr std::size_t STREAM_CHUNK_SIZE{ 4096 };
+    // Smaller programs are not worth splitting; subtrees are never split below MIN_GRAIN instructions
+    static constexpr std::size_t PARALLEL_THRESHOLD{ 1 << 16 };
+    static constexpr std::size_t MIN_GRAIN{ 1 << 12 };
+    // Both stacks are vectors so that the interpreter can work on raw pointers and operators can
+    // reach below the top; m_nums is kept at the program's maximum depth and m_depth marks its top
+    std::vector<std::int64_t> m_nums;
+    std::size_t               m_depth{ 0 };
+    std::vector<BigInt>       m_big_nums;
+    bool                      m_promoted{ false };
+
+    static bool compileChunk( std::string_view expression, CompileState& state, Program& program,
+                              std::size_t max_instructions );
+
+    static std::shared_ptr<const Program> compileCached( const std::string& expression );
+
+    void   reset();
+    void        run( const Program& program, std::size_t begin, std::size_t end );
+    std::size_t runFast( const Program& program, std::size_t begin, std::size_t end );
+    void        runBig( const Program& program, std::size_t begin, std::size_t end );
+    BigInt      finish( const Program& program );
+    void        pushValue( const BigInt& value );
+    void        promote();
 };
 
 // Helper functions
-bool isOperator( const char c );
-bool isSpace( const char c );
+const RPN::OperatorInfo* findOperator( std::string_view name );
+bool        isOperator( const char c );
+bool        isLetter( const char c );
+bool        isSpace( const char c );
+std::size_t numberEnd( std::string_view str, std::size_t pos );
+std::string describeExpression( std::string_view expression );
 
 #endif /* RPN_HPP */
@@ -0,0 +1,373 @@
+#include "ExpressionCache.hpp"
+#include "RPN.hpp"
+#include "WorkStealingPool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <iomanip>
+#include <iostream>
+#include <memory>
+#include <random>
+#include <string>
+#include <vector>
+
+// Benchmark for RPN::evaluate: large generated expressions and batches of short ones
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+// Shape of the stack while the expression is evaluated
+enum class DepthProfile
+{
+    Shallow,  // Number, number, operator, number, operator... (depth never exceeds 2)
+    Deep,     // All numbers first, then all operators (depth grows to half the tokens)
+    Random,   // Random valid interleaving
+    Balanced, // Balanced binary tree (wide independent subtrees, the best case for evaluateParallel)
+};
+
+struct Options
+{
+    std::vector<std::size_t>  token_counts{ 10, 1'000, 100'000, 1'000'000, 10'000'000 };
+    std::vector<DepthProfile> profiles{ DepthProfile::Shallow, DepthProfile::Deep, DepthProfile::Random,
+                                        DepthProfile::Balanced };
+    std::string               ops{ "+-*/" }; // Each character is one unit of weight
+    std::size_t               batch_size{ 100'000 };
+    std::size_t               batch_distinct{ 2'000 };
+    std::size_t               short_tokens{ 15 };
+    int                       repeat{ 7 };
+    std::uint32_t             seed{ 42 };
+    unsigned                  threads{ 0 }; // Also time evaluateParallel if set
+};
+
+const char* profileName( DepthProfile profile )
+{
+    if ( profile == DepthProfile::Shallow )
+        return "shallow";
+    if ( profile == DepthProfile::Deep )
+        return "deep";
+    if ( profile == DepthProfile::Balanced )
+        return "balanced";
+    return "random";
+}
+
+// Keeps generated values small enough to stay on the 64-bit fast path
+constexpr std::int64_t VALUE_LIMIT{ std::int64_t{ 1 } << 40 };
+
+bool applyChecked( std::int64_t first, std::int64_t second, char op, std::int64_t& result )
+{
+    if ( op == '+' )
+        result = first + second;
+    else if ( op == '-' )
+        result = first - second;
+    else if ( op == '*' )
+    {
+        if ( __builtin_mul_overflow( first, second, &result ) )
+            return false;
+    }
+    else if ( op == '/' || op == '%' )
+    {
+        if ( second == 0 )
+            return false;
+        result = op == '/' ? first / second : first % second;
+    }
+    else
+        return false;
+
+    return result < VALUE_LIMIT && result > -VALUE_LIMIT;
+}
+
+// Choose an operator from the mix, falling back to + or - (one of which always stays within the limit)
+char pickOperator( std::int64_t first, std::int64_t second, const std::string& ops, std::mt19937& rng,
+                   std::int64_t& result )
+{
+    std::uniform_int_distribution<std::size_t> op_pick{ 0, ops.size() - 1 };
+
+    char op{ ops[op_pick( rng )] };
+    if ( !applyChecked( first, second, op, result ) )
+    {
+        op = '+';
+        if ( !applyChecked( first, second, op, result ) )
+        {
+            op = '-';
+            applyChecked( first, second, op, result );
+        }
+    }
+
+    return op;
+}
+
+// Append a balanced tree of number_count numbers to expression and return its value
+std::int64_t generateBalanced( std::size_t number_count, const std::string& ops, std::mt19937& rng,
+                               std::string& expression )
+{
+    if ( number_count == 1 )
+    {
+        int num{ std::uniform_int_distribution<int>{ 0, 9 }( rng ) };
+        expression += static_cast<char>( '0' + num );
+        expression += ' ';
+        return num;
+    }
+
+    std::int64_t first{ generateBalanced( number_count / 2, ops, rng, expression ) };
+    std::int64_t second{ generateBalanced( number_count - number_count / 2, ops, rng, expression ) };
+    std::int64_t result;
+
+    expression += pickOperator( first, second, ops, rng, result );
+    expression += ' ';
+    return result;
+}
+
+// Generate a valid expression of (about) token_count tokens; values are tracked so that the
+// expression never divides by zero and never leaves the 64-bit fast path
+std::string generateExpression( std::size_t token_count, DepthProfile profile, const std::string& ops,
+                                std::mt19937& rng )
+{
+    std::size_t numbers_left{ token_count / 2 + 1 };
+    std::size_t ops_left{ numbers_left - 1 };
+
+    std::vector<std::int64_t> stack;
+    std::string               expression;
+    expression.reserve( token_count * 2 );
+
+    if ( profile == DepthProfile::Balanced )
+    {
+        generateBalanced( numbers_left, ops, rng, expression );
+        return expression;
+    }
+
+    std::uniform_int_distribution<int> digit{ 0, 9 };
+    std::bernoulli_distribution        coin{ 0.5 };
+
+    while ( numbers_left > 0 || ops_left > 0 )
+    {
+        bool push_number{ false };
+        if ( stack.size() < 2 )
+            push_number = true;
+        else if ( numbers_left == 0 )
+            push_number = false;
+        else if ( profile == DepthProfile::Deep )
+            push_number = true;
+        else if ( profile == DepthProfile::Random )
+            push_number = coin( rng );
+
+        if ( push_number )
+        {
+            int num{ digit( rng ) };
+            stack.push_back( num );
+            expression += static_cast<char>( '0' + num );
+            --numbers_left;
+        }
+        else
+        {
+            std::int64_t second{ stack.back() };
+            stack.pop_back();
+            std::int64_t first{ stack.back() };
+
+            std::int64_t result;
+            expression += pickOperator( first, second, ops, rng, result );
+            stack.back() = result;
+            --ops_left;
+        }
+        expression += ' ';
+    }
+
+    return expression;
+}
+
+// Time a callable repeatedly (after one warm-up run) and return the median in seconds
+template <typename Callable>
+double medianSeconds( int repeat, Callable&& callable )
+{
+    callable();
+
+    std::vector<double> times;
+    for ( int i{ 0 }; i < repeat; ++i )
+    {
+        auto begin{ Clock::now() };
+        callable();
+        times.push_back( std::chrono::duration<double>( Clock::now() - begin ).count() );
+    }
+
+    std::sort( times.begin(), times.end() );
+    return times[times.size() / 2];
+}
+
+void benchLarge( const Options& options )
+{
+    std::cout << "Large expressions (median of " << options.repeat << " runs, fewer from 1M tokens)\n";
+    std::cout << std::left << std::setw( 10 ) << "profile" << std::right << std::setw( 12 ) << "tokens"
+              << std::setw( 16 ) << "median (ms)" << std::setw( 18 ) << "Mtokens/s";
+    if ( options.threads > 0 )
+        std::cout << std::setw( 24 ) << "parallel Mtokens/s";
+    std::cout << '\n';
+
+    std::mt19937                      rng{ options.seed };
+    std::unique_ptr<WorkStealingPool> pool;
+    if ( options.threads > 0 )
+        pool = std::make_unique<WorkStealingPool>( options.threads );
+
+    for ( auto profile : options.profiles )
+    {
+        for ( auto token_count : options.token_counts )
+        {
+            std::string expression{ generateExpression( token_count, profile, options.ops, rng ) };
+            RPN         rpn;
+            BigInt      sink;
+
+            // Scale repetitions down for huge inputs so the suite finishes in reasonable time
+            int    repeat{ token_count >= 1'000'000 ? std::max( 3, options.repeat / 2 ) : options.repeat };
+            double seconds{ medianSeconds( repeat, [&]() { sink = rpn.evaluate( expression ); } ) };
+
+            std::cout << std::left << std::setw( 10 ) << profileName( profile ) << std::right << std::setw( 12 )
+                      << token_count << std::setw( 16 ) << std::fixed << std::setprecision( 3 ) << seconds * 1e3
+                      << std::setw( 18 ) << std::setprecision( 2 ) << token_count / seconds / 1e6;
+
+            if ( pool )
+            {
+                double parallel_seconds{ medianSeconds(
+                    repeat, [&]() { sink = rpn.evaluateParallel( expression, *pool ); } ) };
+                std::cout << std::setw( 24 ) << token_count / parallel_seconds / 1e6;
+            }
+            std::cout << '\n';
+        }
+    }
+}
+
+void benchBatch( const Options& options )
+{
+    std::cout << "\nBatches of " << options.batch_size << " expressions of " << options.short_tokens
+              << " tokens (median of " << options.repeat << " runs)\n";
+    std::cout << std::left << std::setw( 28 ) << "workload" << std::right << std::setw( 16 ) << "median (ms)"
+              << std::setw( 18 ) << "Mexpr/s" << std::setw( 12 ) << "hit rate" << '\n';
+
+    std::mt19937 rng{ options.seed };
+
+    // Recurring workload: a few thousand distinct expressions, repeated throughout the batch
+    std::vector<std::string> distinct;
+    for ( std::size_t i{ 0 }; i < options.batch_distinct; ++i )
+        distinct.push_back( generateExpression( options.short_tokens, DepthProfile::Random, options.ops, rng ) );
+
+    std::vector<std::string>                   recurring;
+    std::uniform_int_distribution<std::size_t> pick{ 0, distinct.size() - 1 };
+    for ( std::size_t i{ 0 }; i < options.batch_size; ++i )
+        recurring.push_back( distinct[pick( rng )] );
+
+    // Unique workload: every expression is different, so every lookup misses
+    std::vector<std::string> unique;
+    for ( std::size_t i{ 0 }; i < options.batch_size; ++i )
+        unique.push_back( generateExpression( options.short_tokens, DepthProfile::Random, options.ops, rng ) +
+                          std::string( i % 7, ' ' ) + std::to_string( i ) + " +" );
+
+    auto run{ [&]( const char* name, const std::vector<std::string>& batch ) {
+        RPN    rpn;
+        BigInt sink;
+
+        RPN::cache().clear();
+        double seconds{ medianSeconds( options.repeat, [&]() {
+            for ( const auto& expression : batch )
+                sink = rpn.evaluate( expression );
+        } ) };
+
+        double lookups{ static_cast<double>( RPN::cache().hits() + RPN::cache().misses() ) };
+        std::cout << std::left << std::setw( 28 ) << name << std::right << std::setw( 16 ) << std::fixed
+                  << std::setprecision( 3 ) << seconds * 1e3 << std::setw( 18 ) << std::setprecision( 2 )
+                  << batch.size() / seconds / 1e6 << std::setw( 11 ) << std::setprecision( 1 )
+                  << ( lookups > 0 ? 100.0 * RPN::cache().hits() / lookups : 0.0 ) << "%\n";
+    } };
+
+    run( "recurring (cached)", recurring );
+    run( "unique (all misses)", unique );
+}
+
+std::vector<std::size_t> parseCounts( const std::string& arg )
+{
+    std::vector<std::size_t> counts;
+    std::size_t              pos{ 0 };
+
+    while ( pos < arg.size() )
+    {
+        std::size_t end{ arg.find( ',', pos ) };
+        if ( end == std::string::npos )
+            end = arg.size();
+        counts.push_back( std::stoul( arg.substr( pos, end - pos ) ) );
+        pos = end + 1;
+    }
+
+    return counts;
+}
+
+void usage()
+{
+    std::cerr << "Usage: ./RPN_bench [--tokens N,N,...] [--profile shallow|deep|random|balanced] [--ops CHARS]\n"
+                 "                   [--batch N] [--distinct N] [--short-tokens N] [--repeat N] [--seed N]\n"
+                 "                   [--threads N]\n"
+                 "  --ops takes operator characters (+-*/%) as weights, e.g. \"++--*/\"\n";
+}
+
+} // namespace
+
+int main( int argc, char** argv )
+{
+    Options options;
+
+    try
+    {
+        for ( int i{ 1 }; i < argc; ++i )
+        {
+            std::string arg{ argv[i] };
+            if ( i + 1 >= argc )
+                throw std::invalid_argument( "missing value for " + arg );
+            std::string value{ argv[++i] };
+
+            if ( arg == "--tokens" )
+                options.token_counts = parseCounts( value );
+            else if ( arg == "--profile" )
+            {
+                if ( value == "shallow" )
+                    options.profiles = { DepthProfile::Shallow };
+                else if ( value == "deep" )
+                    options.profiles = { DepthProfile::Deep };
+                else if ( value == "random" )
+                    options.profiles = { DepthProfile::Random };
+                else if ( value == "balanced" )
+                    options.profiles = { DepthProfile::Balanced };
+                else
+                    throw std::invalid_argument( "unknown profile " + value );
+            }
+            else if ( arg == "--ops" )
+            {
+                if ( value.empty() || value.find_first_not_of( "+-*/%" ) != std::string::npos )
+                    throw std::invalid_argument( "invalid operator mix " + value );
+                options.ops = value;
+            }
+            else if ( arg == "--batch" )
+                options.batch_size = std::stoul( value );
+            else if ( arg == "--distinct" )
+                options.batch_distinct = std::max<std::size_t>( 1, std::stoul( value ) );
+            else if ( arg == "--short-tokens" )
+                options.short_tokens = std::stoul( value );
+            else if ( arg == "--repeat" )
+                options.repeat = std::max( 1, std::stoi( value ) );
+            else if ( arg == "--threads" )
+                options.threads = static_cast<unsigned>( std::stoul( value ) );
+            else if ( arg == "--seed" )
+                options.seed = static_cast<std::uint32_t>( std::stoul( value ) );
+            else
+                throw std::invalid_argument( "unknown option " + arg );
+        }
+    }
+    catch ( const std::exception& e )
+    {
+        std::cerr << "Error: " << e.what() << '\n';
+        usage();
+        return 1;
+    }
+
+    benchLarge( options );
+    benchBatch( options );
+
+    return 0;
+}
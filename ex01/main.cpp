@@ -1,19 +1,66 @@
+#include "MappedFile.hpp"
 #include "RPN.hpp"
+#include "WorkStealingPool.hpp"
 #include <iostream>
+#include <string>
+#include <string_view>
 
 int main( int argc, char** argv )
 {
-    if ( argc != 2 )
+    int      arg_idx{ 1 };
+    unsigned threads{ 0 };
+
+    // Optional --threads N: evaluate large expressions in parallel
+    if ( argc > 2 && std::string_view{ argv[1] } == "--threads" )
     {
-        std::cerr << "Usage: ./RPN <expression to evaluate>" << '\n';
+        try
+        {
+            threads = static_cast<unsigned>( std::stoul( argv[2] ) );
+        }
+        catch ( const std::exception& )
+        {
+            threads = 0;
+        }
+        arg_idx = 3;
+    }
+
+    bool from_file{ argc - arg_idx == 2 && std::string_view{ argv[arg_idx] } == "--file" };
+
+    if ( ( argc - arg_idx != 1 && !from_file ) || ( arg_idx == 3 && threads == 0 ) )
+    {
+        std::cerr << "Usage: ./RPN [--threads <count>] <expression to evaluate>" << '\n';
+        std::cerr << "       ./RPN [--threads <count>] --file <file containing the expression>" << '\n';
         return 1;
     }
 
     try
     {
-        RPN  rpn;
-        auto result{ rpn.evaluate( argv[1] ) };
-        std::cout << result << '\n';
+        RPN rpn;
+
+        if ( from_file )
+        {
+            // Evaluated straight from the mapping, so the expression is not limited by ARG_MAX
+            MappedFile file{ argv[arg_idx + 1] };
+
+            if ( threads > 0 )
+            {
+                // The parallel engine needs the whole program in memory
+                WorkStealingPool pool{ threads };
+                std::cout << rpn.executeParallel( RPN::compile( file.view() ), pool ) << '\n';
+            }
+            else
+                std::cout << rpn.evaluateStream( file.view() ) << '\n';
+        }
+        else if ( threads > 0 )
+        {
+            WorkStealingPool pool{ threads };
+            std::cout << rpn.evaluateParallel( argv[arg_idx], pool ) << '\n';
+        }
+        else
+        {
+            auto result{ rpn.evaluate( argv[arg_idx] ) };
+            std::cout << result << '\n';
+        }
     }
     catch ( const std::exception& e )
     {
@@ -0,0 +1,495 @@
+#include "ExternalSort.hpp"
+#include "PmergeMe.hpp"
+#include <cerrno>
+#include <charconv>       // std::from_chars
+#include <cstdint>
+#include <cstdlib>        // std::getenv, mkstemp
+#include <cstring>        // std::memmove, std::strerror
+#include <fcntl.h>        // open, posix_fadvise
+#include <malloc.h>       // malloc_trim
+#include <sys/resource.h> // getrusage
+#include <unistd.h>       // read, pread, unlink, close
+
+// Memory per number while a chunk is sorted, from the buffers of the engine at their peak, in indexes:
+// - mergeInsertionSort(): the index of every number
+// - fordJohnsonOrder() at the top level: larger_pos, smaller_pos, larger_ids, pair_order and initial_chain (half
+//   an index each), pending and partner (half an index each), and the order returned by flatten()
+// - MainChain: m_block_of, and m_slots, whose blocks are at least half full and which growing may have left
+//   twice as large as that
+// The recursion on the pairs needs half as much, while only the pairing buffers of the caller are alive.
+// sortAdaptive() also keeps the merge buffer of mergeRuns(), which takes the shorter of two runs (half the
+// chunk). Radix sort needs a buffer as large as the chunk
+constexpr std::size_t FORD_JOHNSON_INDEXES_PER_NUMBER{ 1 + ( 5 + 2 ) / 2 + 1 + 1 + 2 * 2 };
+constexpr std::size_t FORD_JOHNSON_BYTES_PER_NUMBER{ sizeof( int ) +
+                                                     FORD_JOHNSON_INDEXES_PER_NUMBER * sizeof( std::size_t ) +
+                                                     sizeof( int ) / 2 };
+constexpr std::size_t RADIX_BYTES_PER_NUMBER{ 2 * sizeof( int ) };
+
+// Input is read in blocks of this size; with the numbers parsed from a block and the output buffer of a run, the
+// I/O takes at most RESERVED_MEMORY out of the limit
+constexpr std::size_t READ_BLOCK_SIZE{ 1 << 20 };
+constexpr std::size_t RESERVED_MEMORY{ 4 << 20 };
+
+// What is left of the limit for the chunk (then for the blocks of the runs) must be at least this
+constexpr std::size_t MIN_WORK_MEMORY{ 1 << 20 };
+
+// When merging, every run gets an equal share of what is left for its block, but never less than this: with
+// more runs than that allows, groups of them are merged into longer runs first
+constexpr std::size_t MIN_RUN_BLOCK_SIZE{ 1 << 16 };
+
+// A 32-bit gap takes at most five 7-bit groups
+constexpr std::size_t MAX_VARINT_SIZE{ 5 };
+
+namespace
+{
+
+// Writes a sorted run as the gaps between consecutive numbers
+class RunWriter
+{
+  public:
+    // OCF (owns its buffer, so it cannot be copied)
+    explicit RunWriter( int fd )
+        : m_out{ fd }
+    {
+    }
+    RunWriter( const RunWriter& other )            = delete;
+    RunWriter& operator=( const RunWriter& other ) = delete;
+    ~RunWriter()                                   = default;
+
+    void push( int value )
+    {
+        // Unsigned arithmetic, so that the gap wraps around the same way when it is added back
+        std::uint32_t gap{ static_cast<std::uint32_t>( value ) - m_previous };
+        m_previous = static_cast<std::uint32_t>( value );
+
+        unsigned char bytes[MAX_VARINT_SIZE];
+        std::size_t   size{ 0 };
+        while ( gap >= 0x80 )
+        {
+            bytes[size++] = static_cast<unsigned char>( gap | 0x80 );
+            gap >>= 7;
+        }
+        bytes[size++] = static_cast<unsigned char>( gap );
+        m_out.writeBinary( bytes, size );
+    }
+
+    void flush()
+    {
+        m_out.flush();
+    }
+
+  private:
+    OutputBuffer  m_out;
+    std::uint32_t m_previous{ 0 };
+};
+
+// Reads a run back a block at a time, with pread() so that the file offset never matters
+class RunReader
+{
+  public:
+    // OCF (owns its block, and is only moved into place)
+    RunReader( int fd, std::size_t block_size, bool read_ahead )
+        : m_fd{ fd }
+        , m_block( std::max( block_size, MAX_VARINT_SIZE ) )
+        , m_read_ahead{ read_ahead }
+    {
+    }
+    RunReader( const RunReader& other )            = delete;
+    RunReader( RunReader&& other )                 = default;
+    RunReader& operator=( const RunReader& other ) = delete;
+    ~RunReader()                                   = default;
+
+    // Next number of the run, or false at its end
+    bool next( int& value )
+    {
+        // A gap may be cut by the end of the block
+        if ( m_end - m_pos < MAX_VARINT_SIZE && !m_at_end )
+            refill();
+        if ( m_pos == m_end )
+            return false;
+
+        std::uint32_t gap{ 0 };
+        for ( unsigned shift{ 0 };; shift += 7 )
+        {
+            if ( m_pos == m_end || shift >= 7 * MAX_VARINT_SIZE )
+                throw ExternalSort::Error( "A temporary run file is corrupted" );
+
+            unsigned char byte{ m_block[m_pos++] };
+            gap |= static_cast<std::uint32_t>( byte & 0x7F ) << shift;
+            if ( byte < 0x80 )
+                break;
+        }
+
+        m_previous += gap;
+        value = static_cast<int>( m_previous );
+        return true;
+    }
+
+  private:
+    int                        m_fd{ -1 };
+    std::vector<unsigned char> m_block{};
+    std::size_t                m_pos{ 0 };
+    std::size_t                m_end{ 0 };
+    off_t                      m_offset{ 0 };
+    bool                       m_read_ahead{ false };
+    bool                       m_at_end{ false };
+    std::uint32_t              m_previous{ 0 };
+
+    void refill()
+    {
+        std::size_t kept{ m_end - m_pos };
+        std::memmove( m_block.data(), m_block.data() + m_pos, kept );
+        m_pos = 0;
+        m_end = kept;
+
+        while ( m_end < m_block.size() )
+        {
+            ssize_t got{ pread( m_fd, m_block.data() + m_end, m_block.size() - m_end, m_offset ) };
+            if ( got < 0 && errno == EINTR )
+                continue;
+            if ( got < 0 )
+                throw ExternalSort::Error( std::string{ "Could not read a temporary run file: " } +
+                                           std::strerror( errno ) );
+            if ( got == 0 )
+            {
+                m_at_end = true;
+                break;
+            }
+            m_end += static_cast<std::size_t>( got );
+            m_offset += got;
+        }
+
+        // Have the next block on its way while this one is merged
+        if ( m_read_ahead && !m_at_end )
+            posix_fadvise( m_fd, m_offset, static_cast<off_t>( m_block.size() ), POSIX_FADV_WILLNEED );
+    }
+};
+
+// Tournament tree over the current number of every run: m_tree[0] holds the winner (smallest number), and
+// every inner node the loser of the match played there, so replacing the winner replays a single path
+class LoserTree
+{
+  public:
+    // OCF (refers to the runs it merges, so it cannot be copied)
+    explicit LoserTree( std::vector<RunReader>& runs )
+        : m_runs{ runs }
+        , m_values( runs.size() )
+        , m_done( runs.size() )
+        , m_tree( runs.size() )
+    {
+        for ( std::size_t run{ 0 }; run < runs.size(); ++run )
+            m_done[run] = !runs[run].next( m_values[run] );
+        m_tree[0] = play( 1 );
+    }
+    LoserTree( const LoserTree& other )            = delete;
+    LoserTree& operator=( const LoserTree& other ) = delete;
+    ~LoserTree()                                   = default;
+
+    // Smallest number left in all runs, or false once they are all done
+    bool pop( int& value )
+    {
+        std::size_t winner{ m_tree[0] };
+        if ( m_done[winner] )
+            return false;
+
+        value          = m_values[winner];
+        m_done[winner] = !m_runs[winner].next( m_values[winner] );
+
+        // Replay the matches on the way up from the winner's leaf
+        for ( std::size_t node{ ( winner + m_tree.size() ) / 2 }; node > 0; node /= 2 )
+            if ( beats( m_tree[node], winner ) )
+                std::swap( m_tree[node], winner );
+        m_tree[0] = winner;
+        return true;
+    }
+
+  private:
+    std::vector<RunReader>&  m_runs;
+    std::vector<int>         m_values{};
+    std::vector<char>        m_done{};
+    std::vector<std::size_t> m_tree{}; // Leaves are the runs, at m_tree.size() + run
+
+    bool beats( std::size_t a, std::size_t b ) const
+    {
+        if ( m_done[a] || m_done[b] )
+            return !m_done[a];
+        return m_values[a] < m_values[b];
+    }
+
+    // Winner of the subtree under node, storing the losers on the way
+    std::size_t play( std::size_t node )
+    {
+        if ( node >= m_tree.size() )
+            return node - m_tree.size();
+
+        std::size_t left{ play( 2 * node ) };
+        std::size_t right{ play( 2 * node + 1 ) };
+        bool        left_wins{ !beats( right, left ) };
+        m_tree[node] = left_wins ? right : left;
+        return left_wins ? left : right;
+    }
+};
+
+// Feed every number of the runs in fds, in order, to sink
+template <typename Sink>
+void mergeRunFiles( const int* fds, std::size_t run_count, std::size_t block_size, bool read_ahead,
+                    const Sink& sink )
+{
+    std::vector<RunReader> runs;
+    runs.reserve( run_count );
+    for ( std::size_t run{ 0 }; run < run_count; ++run )
+        runs.emplace_back( fds[run], block_size, read_ahead );
+
+    LoserTree tree{ runs };
+    int       value{ 0 };
+    while ( tree.pop( value ) )
+        sink( value );
+}
+
+} // namespace
+
+ExternalSort::ExternalSort( std::size_t memory_limit, bool use_radix, bool read_ahead )
+    : m_memory_limit{ std::max( memory_limit, MIN_MEMORY ) }
+    , m_use_radix{ use_radix }
+    , m_read_ahead{ read_ahead }
+{
+    // The limit is for the whole process: what it already holds (its code, the libraries) is not available
+    std::size_t resident{ residentMemory() };
+    if ( m_memory_limit < resident + RESERVED_MEMORY + MIN_WORK_MEMORY )
+        throw Error( "The memory limit is too small: the program already uses " + std::to_string( resident >> 10 ) +
+                     " KiB, and needs " + std::to_string( ( RESERVED_MEMORY + MIN_WORK_MEMORY ) >> 10 ) +
+                     " KiB more" );
+    m_work_memory = m_memory_limit - resident - RESERVED_MEMORY;
+
+    std::size_t bytes_per_number{ use_radix ? RADIX_BYTES_PER_NUMBER : FORD_JOHNSON_BYTES_PER_NUMBER };
+    m_chunk_capacity = m_work_memory / bytes_per_number;
+    m_chunk.reserve( m_chunk_capacity );
+}
+
+ExternalSort::~ExternalSort()
+{
+    for ( int fd : m_run_fds )
+        close( fd );
+}
+
+// The input is read in blocks (a file is read only once, so it is not mapped); the numbers of a block go to the
+// chunk a part at a time, so that a chunk never grows past its capacity
+void ExternalSort::sortFile( const std::string& path )
+{
+    PMERGEME_PHASES( phases );
+    PMERGEME_PHASE( phases, "reading" );
+
+    bool        from_stdin{ path == "-" };
+    std::string name{ from_stdin ? std::string{ "the standard input" } : path };
+    int         fd{ from_stdin ? STDIN_FILENO : open( path.c_str(), O_RDONLY ) };
+    if ( fd < 0 )
+        throw Error( "Could not open " + path + ": " + std::strerror( errno ) );
+    if ( !from_stdin )
+        posix_fadvise( fd, 0, 0, POSIX_FADV_SEQUENTIAL );
+
+    try
+    {
+        std::vector<char> block( READ_BLOCK_SIZE );
+        std::vector<int>  numbers;
+        std::size_t       kept{ 0 }; // Start of a number cut by the end of the previous block
+        while ( true )
+        {
+            ssize_t got{ read( fd, block.data() + kept, block.size() - kept ) };
+            if ( got < 0 && errno == EINTR )
+                continue;
+            if ( got < 0 )
+                throw Error( "Could not read " + name + ": " + std::strerror( errno ) );
+
+            const char* end{ block.data() + kept + got };
+            numbers.clear();
+            const char* rest{ parseNumbers( block.data(), end, got == 0, numbers ) };
+
+            for ( std::size_t taken{ 0 }; taken < numbers.size(); )
+            {
+                std::size_t count{ std::min( numbers.size() - taken, m_chunk_capacity - m_chunk.size() ) };
+                m_chunk.insert( m_chunk.end(), numbers.begin() + static_cast<std::ptrdiff_t>( taken ),
+                                numbers.begin() + static_cast<std::ptrdiff_t>( taken + count ) );
+                taken += count;
+                if ( m_chunk.size() == m_chunk_capacity )
+                {
+                    PMERGEME_PHASE( phases, "spilling" );
+                    spill();
+                    PMERGEME_PHASE( phases, "reading" );
+                }
+            }
+            m_size += numbers.size();
+            if ( got == 0 )
+                break;
+
+            // A "number" that fills a whole block cannot be valid
+            kept = static_cast<std::size_t>( end - rest );
+            if ( kept == block.size() )
+                throw PmergeMe::InvalidArgument( "The list of numbers provided is not valid." );
+            std::memmove( block.data(), rest, kept );
+        }
+    }
+    catch ( ... )
+    {
+        if ( !from_stdin )
+            close( fd );
+        throw;
+    }
+    if ( !from_stdin )
+        close( fd );
+
+    if ( m_size == 0 )
+        throw PmergeMe::InvalidArgument( "No numbers to sort in " + name );
+}
+
+void ExternalSort::merge( OutputBuffer& out, bool binary )
+{
+    PMERGEME_PHASES( phases );
+
+    auto write_number{ [&]( int value ) {
+        if ( binary )
+            out.writeBinary( &value, sizeof( value ) );
+        else
+            out << value << ' ';
+    } };
+
+    // Everything fit in one chunk: no files at all
+    if ( m_run_fds.empty() )
+    {
+        sortChunk();
+        PMERGEME_PHASE( phases, "merging" );
+        for ( int value : m_chunk )
+            write_number( value );
+    }
+    else
+    {
+        if ( !m_chunk.empty() )
+        {
+            PMERGEME_PHASE( phases, "spilling" );
+            spill();
+        }
+        m_chunk = std::vector<int>{};
+
+        // Every run needs a block, and the output one more buffer; with too many runs, the oldest ones are merged
+        // into a new run until few enough are left (every number is then read and written once more)
+        PMERGEME_PHASE( phases, "merging" );
+        std::size_t merge_memory{ m_work_memory };
+        std::size_t fan_in{ std::max<std::size_t>( merge_memory / MIN_RUN_BLOCK_SIZE, 2 ) };
+        while ( m_run_fds.size() > fan_in )
+        {
+            int       fd{ createRunFile() };
+            RunWriter writer{ fd };
+            m_run_fds.push_back( fd );
+            mergeRunFiles( m_run_fds.data(), fan_in, merge_memory / fan_in, m_read_ahead,
+                           [&]( int value ) { writer.push( value ); } );
+            writer.flush();
+
+            for ( std::size_t run{ 0 }; run < fan_in; ++run )
+                close( m_run_fds[run] );
+            m_run_fds.erase( m_run_fds.begin(), m_run_fds.begin() + static_cast<std::ptrdiff_t>( fan_in ) );
+        }
+
+        mergeRunFiles( m_run_fds.data(), m_run_fds.size(), merge_memory / m_run_fds.size(), m_read_ahead,
+                       write_number );
+    }
+
+    if ( !binary )
+        out << '\n';
+}
+
+std::size_t ExternalSort::size() const
+{
+    return m_size;
+}
+
+std::size_t ExternalSort::runCount() const
+{
+    return m_run_count;
+}
+
+std::size_t ExternalSort::parseMemorySize( std::string_view text )
+{
+    std::size_t value{ 0 };
+    auto [end, error]{ std::from_chars( text.data(), text.data() + text.size(), value ) };
+    if ( error != std::errc{} )
+        return 0;
+
+    std::string_view suffix{ end, static_cast<std::size_t>( text.data() + text.size() - end ) };
+    unsigned         shift{ 0 };
+    if ( suffix == "K" )
+        shift = 10;
+    else if ( suffix == "M" )
+        shift = 20;
+    else if ( suffix == "G" )
+        shift = 30;
+    else if ( !suffix.empty() )
+        return 0;
+
+    if ( value > ( SIZE_MAX >> shift ) || ( value << shift ) < MIN_MEMORY )
+        return 0;
+    return value << shift;
+}
+
+// Private helpers
+
+// Comparisons are not reported here, so presorted chunks may be merged from their runs
+void ExternalSort::sortChunk()
+{
+    if ( m_use_radix )
+        PmergeMe::radixSort( m_chunk );
+    else
+        PmergeMe::sortAdaptive( m_chunk );
+}
+
+// Peak resident memory of the process so far (Linux reports it in KiB)
+std::size_t ExternalSort::residentMemory()
+{
+    rusage usage{};
+    if ( getrusage( RUSAGE_SELF, &usage ) < 0 )
+        return 0;
+    return static_cast<std::size_t>( usage.ru_maxrss ) << 10;
+}
+
+// The file is registered before it is written, so that the destructor closes it whatever happens
+void ExternalSort::spill()
+{
+    sortChunk();
+    // glibc keeps what the engine freed in its heap once the first large buffers have been unmapped, and the
+    // blocks of the runs would then come on top of it
+    malloc_trim( 0 );
+
+    int fd{ createRunFile() };
+    m_run_fds.push_back( fd );
+    ++m_run_count;
+
+    RunWriter writer{ fd };
+    for ( int value : m_chunk )
+        writer.push( value );
+    writer.flush();
+    m_chunk.clear();
+}
+
+// In $TMPDIR (or /tmp), and unlinked at once: the file lives as long as its descriptor, even after a crash
+int ExternalSort::createRunFile() const
+{
+    const char* directory{ std::getenv( "TMPDIR" ) };
+    std::string path{ std::string{ directory && *directory ? directory : "/tmp" } + "/PmergeMe.run.XXXXXX" };
+
+    int fd{ mkstemp( path.data() ) };
+    if ( fd < 0 )
+        throw Error( "Could not create a temporary run file in " + path.substr( 0, path.rfind( '/' ) ) + ": " +
+                     std::strerror( errno ) );
+    unlink( path.c_str() );
+    return fd;
+}
+
+// Exception class
+
+ExternalSort::Error::Error( std::string_view error )
+    : m_error{ error }
+{
+}
+
+const char* ExternalSort::Error::what() const noexcept
+{
+    return m_error.c_str();
+}
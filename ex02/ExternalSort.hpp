@@ -0,0 +1,72 @@
+#ifndef EXTERNALSORT_HPP
+#define EXTERNALSORT_HPP
+
+#include "OutputBuffer.hpp"
+#include <cstddef>
+#include <exception>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Sort of more numbers than fit in memory: the input is read in chunks that fit the memory limit, every chunk is
+// sorted in memory and spilled to a temporary file as a sorted run, then the runs are merged with a loser tree.
+// Runs hold the gaps between consecutive numbers in 7-bit groups (LEB128), so dense keys take a byte or two each
+class ExternalSort
+{
+  public:
+    // OCF (the run files have a single owner, so it cannot be copied)
+    // memory_limit bounds the resident memory of the whole process; throw Error if the process already uses
+    // too much of it. Chunks are sorted with PmergeMe::sortAdaptive(), or radix sort if use_radix; with read_ahead, the kernel
+    // is asked to fetch the next block of every run while the current one is merged
+    ExternalSort( std::size_t memory_limit, bool use_radix = false, bool read_ahead = false );
+    ExternalSort( const ExternalSort& other )            = delete;
+    ExternalSort& operator=( const ExternalSort& other ) = delete;
+    ~ExternalSort(); // Closes the run files, which are deleted as soon as they are created
+
+    // Read the numbers of path ("-" for the standard input), validated like PmergeMe::readNumbers(), spilling
+    // every chunk that fills up
+    void sortFile( const std::string& path );
+
+    // Write all the numbers in order to out: as text separated by spaces and ending with a newline, or as raw
+    // ints in native byte order if binary
+    void merge( OutputBuffer& out, bool binary );
+
+    std::size_t size() const;     // Numbers read
+    std::size_t runCount() const; // Chunks spilled to files (0 if everything fit in memory)
+
+    // Bytes in text: a number with an optional K, M or G suffix; 0 if it is not valid or below MIN_MEMORY
+    static std::size_t parseMemorySize( std::string_view text );
+
+    // Room for the program itself, the I/O buffers and at least a few thousand numbers
+    static constexpr std::size_t MIN_MEMORY{ 16 << 20 };
+
+    // Exception class
+    class Error : public std::exception
+    {
+      public:
+        Error( std::string_view error );
+        const char* what() const noexcept override;
+
+      private:
+        const std::string m_error{};
+    };
+
+  private:
+    std::size_t      m_memory_limit{ MIN_MEMORY };
+    std::size_t      m_work_memory{ 0 }; // For the chunk, then the blocks of the runs
+    bool             m_use_radix{ false };
+    bool             m_read_ahead{ false };
+    std::vector<int> m_chunk{}; // Numbers not spilled yet
+    std::size_t      m_chunk_capacity{ 0 };
+    std::vector<int> m_run_fds{};
+    std::size_t      m_size{ 0 };
+    std::size_t      m_run_count{ 0 };
+
+    static std::size_t residentMemory();
+
+    void sortChunk();
+    void spill();
+    int  createRunFile() const;
+};
+
+#endif /* EXTERNALSORT_HPP */
@@ -0,0 +1,139 @@
+#ifndef JACOBSTHALORDER_HPP
+#define JACOBSTHALORDER_HPP
+
+#include <algorithm>
+#include <array>
+#include <cstddef>
+#include <iterator>
+
+// Jacobsthal numbers J(0), J(1)...: J(n) = J(n - 1) + 2 * J(n - 2); J(65) is the last one in 64 bits
+constexpr std::size_t JACOBSTHAL_COUNT{ 66 };
+
+constexpr std::array<std::size_t, JACOBSTHAL_COUNT> makeJacobsthalTable()
+{
+    std::array<std::size_t, JACOBSTHAL_COUNT> table{};
+    table[1] = 1;
+    for ( std::size_t n{ 2 }; n < JACOBSTHAL_COUNT; ++n )
+        table[n] = table[n - 1] + 2 * table[n - 2];
+    return table;
+}
+
+constexpr std::array<std::size_t, JACOBSTHAL_COUNT> JACOBSTHAL{ makeJacobsthalTable() };
+static_assert( JACOBSTHAL[5] == 11 && JACOBSTHAL[10] == 341, "Jacobsthal table" );
+
+// Order in which Ford-Johnson inserts count pending elements (0-based indexes), generated on the fly:
+// group k holds the indexes up to J(k + 3) - 2 that the previous groups did not, in decreasing order
+// (1 0, 3 2, 9 8 7 6 5 4, 19 ... 10...), the last group being cut at count - 1
+class JacobsthalOrder
+{
+  public:
+    class Iterator
+    {
+      public:
+        using iterator_category = std::forward_iterator_tag;
+        using value_type        = std::size_t;
+        using difference_type   = std::ptrdiff_t;
+        using pointer           = const std::size_t*;
+        using reference         = const std::size_t&;
+
+        // OCF
+        Iterator()                                   = default;
+        Iterator( const Iterator& other )            = default;
+        Iterator& operator=( const Iterator& other ) = default;
+        ~Iterator()                                  = default;
+
+        // The first index of a range of count indexes, or the end if at_end
+        Iterator( std::size_t count, bool at_end )
+            : m_count{ count }
+            , m_high{ std::min( JACOBSTHAL[3] - 2, count - 1 ) }
+            , m_index{ at_end || count == 0 ? count : m_high }
+        {
+        }
+
+        reference operator*() const
+        {
+            return m_index;
+        }
+
+        Iterator& operator++()
+        {
+            if ( m_index > m_low )
+            {
+                --m_index;
+                return *this;
+            }
+
+            // Next group: from the next bound (or the last index) down to just above this group
+            m_low   = m_high + 1;
+            m_high  = std::min( JACOBSTHAL[++m_group + 3] - 2, m_count - 1 );
+            m_index = m_low < m_count ? m_high : m_count;
+            return *this;
+        }
+
+        Iterator operator++( int )
+        {
+            Iterator previous{ *this };
+            ++*this;
+            return previous;
+        }
+
+        bool operator==( const Iterator& other ) const
+        {
+            return m_index == other.m_index;
+        }
+
+        bool operator!=( const Iterator& other ) const
+        {
+            return m_index != other.m_index;
+        }
+
+        // Bounds of the current group: its indexes are low() to high(), visited from high() down
+        std::size_t low() const
+        {
+            return m_low;
+        }
+
+        std::size_t high() const
+        {
+            return m_high;
+        }
+
+      private:
+        std::size_t m_count{ 0 };
+        std::size_t m_group{ 0 };
+        std::size_t m_low{ 0 };
+        std::size_t m_high{ 0 };
+        std::size_t m_index{ 0 }; // m_count once past the end
+    };
+
+    // OCF
+    JacobsthalOrder()                                          = default;
+    JacobsthalOrder( const JacobsthalOrder& other )            = default;
+    JacobsthalOrder& operator=( const JacobsthalOrder& other ) = default;
+    ~JacobsthalOrder()                                         = default;
+
+    explicit JacobsthalOrder( std::size_t count )
+        : m_count{ count }
+    {
+    }
+
+    Iterator begin() const
+    {
+        return Iterator{ m_count, false };
+    }
+
+    Iterator end() const
+    {
+        return Iterator{ m_count, true };
+    }
+
+    std::size_t size() const
+    {
+        return m_count;
+    }
+
+  private:
+    std::size_t m_count{ 0 };
+};
+
+#endif /* JACOBSTHALORDER_HPP */
@@ -0,0 +1,176 @@
+#include "MainChain.hpp"
+#include <algorithm>
+
+MainChain::MainChain( const std::vector<std::size_t>& values, std::size_t capacity )
+    : m_block_of( capacity )
+    , m_size{ values.size() }
+{
+    // Start with half-full blocks, so that the first insertions do not split them right away
+    for ( std::size_t begin{ 0 }; begin < values.size(); begin += BLOCK_SIZE / 2 )
+    {
+        std::size_t end{ std::min( begin + BLOCK_SIZE / 2, values.size() ) };
+        std::size_t id{ newBlock() };
+
+        std::copy( values.begin() + begin, values.begin() + end, m_slots.begin() + id * BLOCK_SIZE );
+        m_counts[id] = end - begin;
+        m_order.push_back( id );
+        for ( std::size_t i{ begin }; i < end; ++i )
+            m_block_of[values[i]] = id;
+    }
+
+    rebuildIndex();
+}
+
+std::size_t MainChain::size() const
+{
+    return m_size;
+}
+
+std::size_t MainChain::at( std::size_t rank ) const
+{
+    std::size_t offset;
+    std::size_t position{ findBlock( rank, offset ) };
+    return m_slots[m_order[position] * BLOCK_SIZE + offset];
+}
+
+std::size_t MainChain::rankOf( std::size_t value ) const
+{
+    std::size_t id{ m_block_of[value] };
+    auto        block{ m_slots.begin() + id * BLOCK_SIZE };
+    auto        offset{ std::find( block, block + m_counts[id], value ) - block };
+
+    return blocksBefore( m_position[id] ) + static_cast<std::size_t>( offset );
+}
+
+void MainChain::insert( std::size_t rank, std::size_t value )
+{
+    // Only a default constructed chain has no block at all
+    if ( m_order.empty() )
+    {
+        m_order.push_back( newBlock() );
+        rebuildIndex();
+    }
+
+    std::size_t offset;
+    std::size_t position;
+    if ( rank == m_size )
+    {
+        // Appending: the rank is past every block, so add to the last one
+        position = m_order.size() - 1;
+        offset   = m_counts[m_order[position]];
+    }
+    else
+        position = findBlock( rank, offset );
+
+    std::size_t id{ m_order[position] };
+    auto        block{ m_slots.begin() + id * BLOCK_SIZE };
+
+    if ( value >= m_block_of.size() )
+        m_block_of.resize( value + 1 );
+    std::copy_backward( block + offset, block + m_counts[id], block + m_counts[id] + 1 );
+    block[offset]     = value;
+    m_block_of[value] = id;
+    addToBlock( position, 1 );
+    ++m_size;
+
+    if ( ++m_counts[id] == BLOCK_SIZE )
+        splitBlock( position );
+}
+
+std::vector<std::size_t> MainChain::flatten() const
+{
+    std::vector<std::size_t> values;
+    values.reserve( m_size );
+
+    for ( auto id : m_order )
+    {
+        auto block{ m_slots.begin() + id * BLOCK_SIZE };
+        values.insert( values.end(), block, block + m_counts[id] );
+    }
+
+    return values;
+}
+
+// Private helpers
+
+// Descend the Fenwick tree to the last position whose preceding blocks hold at most rank elements
+std::size_t MainChain::findBlock( std::size_t rank, std::size_t& offset ) const
+{
+    std::size_t count{ m_order.size() };
+    std::size_t step{ 1 };
+    while ( step * 2 <= count )
+        step *= 2;
+
+    std::size_t position{ 0 };
+    for ( ; step > 0; step /= 2 )
+    {
+        if ( position + step <= count && m_tree[position + step] <= rank )
+        {
+            position += step;
+            rank -= m_tree[position];
+        }
+    }
+
+    offset = rank;
+    return position;
+}
+
+std::size_t MainChain::blocksBefore( std::size_t position ) const
+{
+    std::size_t sum{ 0 };
+    for ( ; position > 0; position &= position - 1 )
+        sum += m_tree[position];
+    return sum;
+}
+
+void MainChain::addToBlock( std::size_t position, std::size_t count )
+{
+    for ( ++position; position < m_tree.size(); position += position & ( 0 - position ) )
+        m_tree[position] += count;
+}
+
+// Allocate an empty block and return its id
+std::size_t MainChain::newBlock()
+{
+    m_slots.resize( m_slots.size() + BLOCK_SIZE );
+    m_counts.push_back( 0 );
+    return m_counts.size() - 1;
+}
+
+// Move the second half of a full block into a new block right after it
+// Rebuilding the index costs O(number of blocks), but a block only fills up again after BLOCK_SIZE / 2
+// insertions, so it adds O(number of blocks / BLOCK_SIZE) per insertion on average
+void MainChain::splitBlock( std::size_t position )
+{
+    std::size_t id{ m_order[position] };
+    std::size_t new_id{ newBlock() };
+    std::size_t half{ m_counts[id] / 2 };
+
+    auto block{ m_slots.begin() + id * BLOCK_SIZE };
+    std::copy( block + half, block + m_counts[id], m_slots.begin() + new_id * BLOCK_SIZE );
+    m_counts[new_id] = m_counts[id] - half;
+    m_counts[id]     = half;
+    for ( std::size_t i{ 0 }; i < m_counts[new_id]; ++i )
+        m_block_of[m_slots[new_id * BLOCK_SIZE + i]] = new_id;
+
+    m_order.insert( m_order.begin() + static_cast<std::ptrdiff_t>( position ) + 1, new_id );
+    rebuildIndex();
+}
+
+// Recompute block positions and the Fenwick tree in O(number of blocks)
+void MainChain::rebuildIndex()
+{
+    m_position.resize( m_counts.size() );
+    m_tree.assign( m_order.size() + 1, 0 );
+
+    for ( std::size_t i{ 0 }; i < m_order.size(); ++i )
+    {
+        m_position[m_order[i]] = i;
+
+        std::size_t node{ i + 1 };
+        m_tree[node] += m_counts[m_order[i]];
+        std::size_t parent{ node + ( node & ( 0 - node ) ) };
+        if ( parent < m_tree.size() )
+            m_tree[parent] += m_tree[node];
+    }
+}
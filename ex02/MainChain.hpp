@@ -0,0 +1,79 @@
+#ifndef MAINCHAIN_HPP
+#define MAINCHAIN_HPP
+
+#include <cstddef>
+#include <vector>
+
+// Main chain of the Ford-Johnson insertion phase: a sequence of distinct values (element positions) that
+// supports access by rank, insertion at a rank and finding the current rank of a value without shifting
+// the whole sequence. It is a list of small fixed-capacity blocks, with a Fenwick tree over the block sizes.
+// With B blocks of up to BLOCK_SIZE values:
+// - at() takes O(log B), a descent of the tree
+// - rankOf() takes O(log B) plus a scan of the value's block, up to BLOCK_SIZE values
+// - insert() takes O(log B) plus a shift of one block; when the block fills up, it is split and the index is
+//   rebuilt in O(B), which happens at most once every BLOCK_SIZE / 2 insertions into that block
+class MainChain
+{
+  public:
+    // OCF
+    MainChain()                                    = default;
+    MainChain( const MainChain& other )            = default;
+    MainChain& operator=( const MainChain& other ) = default;
+    ~MainChain()                                   = default;
+
+    // values must be distinct and below capacity, and so must all values inserted later
+    MainChain( const std::vector<std::size_t>& values, std::size_t capacity );
+
+    std::size_t size() const;
+    std::size_t at( std::size_t rank ) const;
+    std::size_t rankOf( std::size_t value ) const;
+
+    // Rank of the first of the first count values for which below( value ) is false, for values ordered by
+    // below; probes the same ranks as std::lower_bound, so it makes as many comparisons
+    template <typename Below>
+    std::size_t lowerBound( std::size_t count, Below below ) const
+    {
+        std::size_t first{ 0 };
+        while ( count > 0 )
+        {
+            std::size_t step{ count / 2 };
+            if ( below( at( first + step ) ) )
+            {
+                first += step + 1;
+                count -= step + 1;
+            }
+            else
+                count = step;
+        }
+        return first;
+    }
+
+    // Insert value so that it ends up at rank
+    void insert( std::size_t rank, std::size_t value );
+
+    // The values in chain order
+    std::vector<std::size_t> flatten() const;
+
+  private:
+    // Blocks are split in two when they reach this size, so inserting never moves more than that
+    static constexpr std::size_t BLOCK_SIZE{ 512 };
+
+    // Block id b holds m_counts[b] values from m_slots[b * BLOCK_SIZE]; block ids never change
+    std::vector<std::size_t> m_slots{};
+    std::vector<std::size_t> m_counts{};
+    std::vector<std::size_t> m_order{};    // Block ids in chain order
+    std::vector<std::size_t> m_position{}; // m_position[id]: index of block id in m_order
+    std::vector<std::size_t> m_tree{};     // Fenwick tree of the block sizes, in chain order (1-based)
+    std::vector<std::size_t> m_block_of{}; // m_block_of[value]: id of the block holding value
+    std::size_t              m_size{ 0 };
+
+    // Find the block holding rank; offset becomes the rank inside that block
+    std::size_t findBlock( std::size_t rank, std::size_t& offset ) const;
+    std::size_t blocksBefore( std::size_t position ) const; // Elements in the first position blocks
+    void        addToBlock( std::size_t position, std::size_t count );
+    std::size_t newBlock();
+    void        splitBlock( std::size_t position );
+    void        rebuildIndex();
+};
+
+#endif /* MAINCHAIN_HPP */
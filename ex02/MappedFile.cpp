@@ -0,0 +1,107 @@
+#include "MappedFile.hpp"
+#include <cerrno>
+#include <cstring>    // std::strerror
+#include <fcntl.h>    // open
+#include <sys/mman.h> // mmap, madvise, munmap
+#include <sys/stat.h> // fstat
+#include <unistd.h>   // close, read
+
+// readAll() reads files that cannot be mapped in blocks of this size
+constexpr std::size_t READ_BLOCK_SIZE{ 1 << 20 };
+
+MappedFile::MappedFile( const std::string& path )
+{
+    int fd{ open( path.c_str(), O_RDONLY ) };
+    if ( fd < 0 )
+        throw FileError( "Could not open " + path + ": " + std::strerror( errno ) );
+
+    struct stat info;
+    if ( fstat( fd, &info ) < 0 )
+    {
+        int error{ errno };
+        close( fd );
+        throw FileError( "Could not read size of " + path + ": " + std::strerror( error ) );
+    }
+
+    // Only a regular file has a size that tells how much there is to read
+    if ( !S_ISREG( info.st_mode ) )
+    {
+        readAll( fd, path );
+        close( fd );
+        return;
+    }
+
+    m_size = static_cast<std::size_t>( info.st_size );
+
+    // mmap does not accept a length of 0; an empty file is simply an empty view
+    if ( m_size > 0 )
+    {
+        void* data{ mmap( nullptr, m_size, PROT_READ, MAP_PRIVATE, fd, 0 ) };
+        if ( data == MAP_FAILED )
+        {
+            int error{ errno };
+            close( fd );
+            throw FileError( "Could not map " + path + ": " + std::strerror( error ) );
+        }
+
+        // The file is read once from front to back: read ahead aggressively and drop pages behind
+        madvise( data, m_size, MADV_SEQUENTIAL );
+        m_data = static_cast<const char*>( data );
+    }
+
+    // The mapping stays valid after the descriptor is closed
+    close( fd );
+}
+
+void MappedFile::readAll( int fd, const std::string& path )
+{
+    while ( true )
+    {
+        std::size_t kept{ m_contents.size() };
+        m_contents.resize( kept + READ_BLOCK_SIZE );
+        ssize_t got{ read( fd, m_contents.data() + kept, READ_BLOCK_SIZE ) };
+        if ( got < 0 && errno == EINTR )
+        {
+            m_contents.resize( kept );
+            continue;
+        }
+        if ( got < 0 )
+        {
+            int error{ errno };
+            close( fd );
+            throw FileError( "Could not read " + path + ": " + std::strerror( error ) );
+        }
+
+        m_contents.resize( kept + static_cast<std::size_t>( got ) );
+        if ( got == 0 )
+            break;
+    }
+
+    // An empty input keeps the empty view of an empty regular file
+    if ( !m_contents.empty() )
+        m_data = m_contents.data();
+    m_size = m_contents.size();
+}
+
+MappedFile::~MappedFile()
+{
+    if ( m_data && m_contents.empty() )
+        munmap( const_cast<char*>( m_data ), m_size );
+}
+
+std::string_view MappedFile::view() const
+{
+    return { m_data, m_size };
+}
+
+// Exception class
+
+MappedFile::FileError::FileError( std::string_view error )
+    : m_error{ error }
+{
+}
+
+const char* MappedFile::FileError::what() const noexcept
+{
+    return m_error.c_str();
+}
@@ -0,0 +1,101 @@
+#include "OutputBuffer.hpp"
+#include <cerrno>
+#include <charconv> // std::to_chars
+#include <cstring>  // std::memcpy, std::strerror
+#include <unistd.h> // write
+
+OutputBuffer::OutputBuffer( int fd )
+    : m_buffer( CAPACITY )
+    , m_fd{ fd }
+{
+}
+
+OutputBuffer::~OutputBuffer()
+{
+    try
+    {
+        flush();
+    }
+    catch ( const WriteError& )
+    {
+    }
+}
+
+OutputBuffer& OutputBuffer::operator<<( int value )
+{
+    // Enough room for any int with its sign
+    if ( CAPACITY - m_size < 16 )
+        flush();
+
+    m_size = static_cast<std::size_t>(
+        std::to_chars( m_buffer.data() + m_size, m_buffer.data() + CAPACITY, value ).ptr - m_buffer.data() );
+    return *this;
+}
+
+OutputBuffer& OutputBuffer::operator<<( char c )
+{
+    if ( m_size == CAPACITY )
+        flush();
+
+    m_buffer[m_size++] = c;
+    return *this;
+}
+
+OutputBuffer& OutputBuffer::operator<<( std::string_view text )
+{
+    writeBinary( text.data(), text.size() );
+    return *this;
+}
+
+void OutputBuffer::writeBinary( const void* data, std::size_t size )
+{
+    if ( size > CAPACITY - m_size )
+        flush();
+
+    // Large blocks are not worth copying into the buffer first
+    if ( size >= CAPACITY )
+        writeAll( static_cast<const char*>( data ), size );
+    else
+    {
+        std::memcpy( m_buffer.data() + m_size, data, size );
+        m_size += size;
+    }
+}
+
+void OutputBuffer::flush()
+{
+    // Emptied first, so that a failed write is not retried by the destructor
+    std::size_t size{ m_size };
+    m_size = 0;
+    writeAll( m_buffer.data(), size );
+}
+
+// Private helpers
+
+// write() may take only part of the data (pipes), or be interrupted by a signal
+void OutputBuffer::writeAll( const char* data, std::size_t size )
+{
+    while ( size > 0 )
+    {
+        ssize_t written{ write( m_fd, data, size ) };
+        if ( written < 0 && errno == EINTR )
+            continue;
+        if ( written < 0 )
+            throw WriteError( std::string{ "Could not write the output: " } + std::strerror( errno ) );
+
+        data += written;
+        size -= static_cast<std::size_t>( written );
+    }
+}
+
+// Exception class
+
+OutputBuffer::WriteError::WriteError( std::string_view error )
+    : m_error{ error }
+{
+}
+
+const char* OutputBuffer::WriteError::what() const noexcept
+{
+    return m_error.c_str();
+}
@@ -0,0 +1,50 @@
+#ifndef OUTPUTBUFFER_HPP
+#define OUTPUTBUFFER_HPP
+
+#include <cstddef>
+#include <exception>
+#include <string>
+#include <string_view>
+#include <vector>
+
+// Output written straight to a file descriptor through one large buffer: numbers are formatted with
+// std::to_chars in place, so printing millions of them costs about as much as copying the text
+class OutputBuffer
+{
+  public:
+    // OCF (the buffer has a single owner, so it cannot be copied)
+    explicit OutputBuffer( int fd = 1 );
+    OutputBuffer( const OutputBuffer& other )            = delete;
+    OutputBuffer& operator=( const OutputBuffer& other ) = delete;
+    ~OutputBuffer(); // Flushes, but ignores errors: call flush() to get them
+
+    OutputBuffer& operator<<( int value );
+    OutputBuffer& operator<<( char c );
+    OutputBuffer& operator<<( std::string_view text );
+
+    // Raw bytes, e.g. the memory of an array of int
+    void writeBinary( const void* data, std::size_t size );
+    void flush();
+
+    // Exception class
+    class WriteError : public std::exception
+    {
+      public:
+        WriteError( std::string_view error );
+        const char* what() const noexcept override;
+
+      private:
+        const std::string m_error{};
+    };
+
+  private:
+    static constexpr std::size_t CAPACITY{ 1 << 20 };
+
+    std::vector<char> m_buffer;
+    std::size_t       m_size{ 0 };
+    int               m_fd{ 1 };
+
+    void writeAll( const char* data, std::size_t size );
+};
+
+#endif /* OUTPUTBUFFER_HPP */
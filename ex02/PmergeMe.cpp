@@ -1,434 +1,260 @@
 #include "PmergeMe.hpp"
+#include "MappedFile.hpp"
+#include <cerrno>
+#include <charconv> // std::from_chars
+#include <cstdint>
+#include <unistd.h> // read
+
+// radixSort(): 32-bit keys in 11-bit digits take three passes
+constexpr unsigned    RADIX_BITS{ 11 };
+constexpr std::size_t RADIX_SIZE{ std::size_t{ 1 } << RADIX_BITS };
+constexpr unsigned    RADIX_PASSES{ ( 32 + RADIX_BITS - 1 ) / RADIX_BITS };
+// Below this many elements, clearing the counts costs more than std::sort
+constexpr std::size_t RADIX_THRESHOLD{ 256 };
+
+// readNumbers() reads the standard input in blocks of this size
+constexpr std::size_t READ_BLOCK_SIZE{ 1 << 20 };
 
 // Main sorting logic with std::vector
 std::vector<int> PmergeMe::sortVector( int argc, char** argv )
 {
-    std::vector vec{ parseArgsVec( argc, argv ) };
-
-    // Nothing to be done if already sorted
-    if ( std::is_sorted( vec.begin(), vec.end() ) )
-        return vec;
-
-    // Create pairs (leave out the odd one for now)
-    std::vector<Pair> pairs_vec{ createSortedPairs( vec ) };
-
-    // Merge sort the pairs
-    pairs_vec = mergeSortPairs( pairs_vec );
-
-    // Insertion into the main chain
-    std::vector<int> sorted_vec;
-    sorted_vec.reserve( vec.size() );
-
-    // First element in main chain is the smaller of the first pair
-    sorted_vec.push_back( pairs_vec[0].second );
-
-    // The rest of main chain consists of all greaters of the pairs because they are already sorted
-    for ( auto& elem : pairs_vec )
-        sorted_vec.push_back( elem.first );
-
-    // Create vector of remaining elements
-    std::vector<int> remaining_vec;
-    remaining_vec.reserve( pairs_vec.size() );
-    for ( auto it{ pairs_vec.begin() + 1 }; it != pairs_vec.end(); ++it )
-        remaining_vec.push_back( ( *it ).second );
-    // Don't forget the left out odd
-    if ( vec.size() % 2 != 0 )
-        remaining_vec.push_back( vec.back() );
-
-    // FJ algorithm uses Jacobsthal numbers to determine the order of insertion
-    std::vector<std::size_t> order_vec{ createJacobsthalOrderVec( remaining_vec.size() ) };
-
-    // Use binary search to insert the remaining numbers into correct positions in the main chain
-    for ( auto idx : order_vec )
-    {
-        // std::lower_bound conducts the binary search for us
-        auto insertion_pos{ std::lower_bound( sorted_vec.begin(), sorted_vec.end(), remaining_vec[idx] ) };
-
-        sorted_vec.insert( insertion_pos, remaining_vec[idx] );
-    }
-
-    return sorted_vec;
+    std::vector vec{ parseArgs<std::vector<int>>( argc, argv ) };
+    sort( vec );
+    return vec;
 }
 
-// Main sorting logic with std::list
-std::list<int> PmergeMe::sortList( int argc, char** argv )
+std::size_t PmergeMe::comparisons()
 {
-    std::list lst{ parseArgsList( argc, argv ) };
-
-    // Nothing to be done if already sorted
-    if ( std::is_sorted( lst.begin(), lst.end() ) )
-        return lst;
-
-    // Create pairs (leave out the odd one for now)
-    std::list<Pair> pairs_list{ createSortedPairs( lst ) };
-
-    // Merge sort the pairs
-    pairs_list = mergeSortPairs( pairs_list );
-
-    // Insertion into the main chain
-    std::list<int> sorted_list;
-
-    // First element in main chain is the smaller of the first pair
-    sorted_list.push_back( pairs_list.front().second );
-
-    // The rest of main chain consists of all greaters of the pairs because they are already sorted
-    for ( auto& elem : pairs_list )
-        sorted_list.push_back( elem.first );
-
-    // Create list of remaining elements
-    std::list<int> remaining_list;
-    for ( auto it{ std::next( pairs_list.begin() ) }; it != pairs_list.end(); ++it )
-        remaining_list.push_back( ( *it ).second );
-    // Don't forget the left out odd
-    if ( lst.size() % 2 != 0 )
-        remaining_list.push_back( lst.back() );
+    return s_comparisons;
+}
 
-    // FJ algorithm uses Jacobsthal numbers to determine the order of insertion
-    std::list<std::size_t> order_list{ createJacobsthalOrderList( remaining_list.size() ) };
+// Worst case of Ford-Johnson: F(n) = sum for k = 1..n of ceil(log2(3k / 4))
+// The term is c for the k with 2^(c+1) < 3k <= 2^(c+2), so the sum is taken a value of c at a time
+std::size_t PmergeMe::comparisonBound( std::size_t size )
+{
+    std::size_t bound{ 0 };
+    std::size_t done{ 1 }; // The term is 0 for k = 1
 
-    // Use binary search to insert the remaining numbers into correct positions in the main chain
-    for ( auto idx : order_list )
+    for ( std::size_t c{ 1 }; done < size; ++c )
     {
-        // std::list does not have operator[], so we use iterator to access the index
-        auto it{ remaining_list.begin() };
-        // Equivalent to remaining_list[idx] (as it were)
-        std::advance( it, idx );
-
-        // std::lower_bound conducts the binary search for us
-        auto insertion_pos{ std::lower_bound( sorted_list.begin(), sorted_list.end(), *it ) };
-
-        sorted_list.insert( insertion_pos, *it );
+        std::size_t last{ std::min( size, ( std::size_t{ 4 } << c ) / 3 ) };
+        bound += c * ( last - done );
+        done = last;
     }
 
-    return sorted_list;
+    return bound;
 }
 
-// Exception class
-
-PmergeMe::InvalidArgument::InvalidArgument( std::string_view error )
-    : m_error{ error }
+// smallest() plays the tournament, or sorts everything when that has the smaller worst case
+std::size_t PmergeMe::selectionBound( std::size_t size, std::size_t k )
 {
+    return std::min( tournamentBound( size, k ), comparisonBound( size ) );
 }
 
-const char* PmergeMe::InvalidArgument::what() const noexcept
+std::size_t PmergeMe::tournamentBound( std::size_t size, std::size_t k )
 {
-    return m_error.c_str();
+    k = std::min( k, size );
+    if ( k == 0 )
+        return 0;
+
+    // Rounds on the longest path from an element to the final
+    std::size_t rounds{ 0 };
+    while ( ( std::size_t{ 1 } << rounds ) < size )
+        ++rounds;
+    return size - 1 + ( k - 1 ) * rounds;
 }
 
-/*----------------Helper functions for vector sorting----------------*/
-
-// Convert argv into std::vector; throw on invalid input
-std::vector<int> parseArgsVec( int argc, char** argv )
+// Main sorting logic with std::list
+std::list<int> PmergeMe::sortList( int argc, char** argv )
 {
-    std::vector<int> vec;
-    vec.reserve( argc - 1 );
-
-    try
-    {
-        std::size_t remaining_pos;
-
-        for ( int i{ 1 }; argv[i]; ++i )
-        {
-            vec.push_back( std::stoi( argv[i], &remaining_pos ) );
-
-            // The arguments must be fully converted to (positive) integers to be considered valid
-            if ( remaining_pos != std::strlen( argv[i] ) || vec.back() < 0 )
-                throw std::exception();
-        }
-    }
-    catch ( const std::exception& )
-    {
-        throw PmergeMe::InvalidArgument( "The list of numbers provided as arguments is not valid." );
-    }
-
-    return vec;
+    std::list lst{ parseArgs<std::list<int>>( argc, argv ) };
+    sort( lst );
+    return lst;
 }
 
-// Create a vector of pairs, first element is always >= the second; last odd element is not paired
-std::vector<Pair> createSortedPairs( const std::vector<int>& vec )
+// Files are parsed straight from a memory mapping; the standard input may be a pipe, so it is read in blocks
+std::vector<int> PmergeMe::readNumbers( const std::string& path )
 {
-    std::vector<Pair> pairs_vec;
+    PMERGEME_PHASES( phases );
+    PMERGEME_PHASE( phases, "reading" );
 
-    for ( size_t i{ 1 }; i < vec.size(); i += 2 )
+    std::vector<int> numbers;
+
+    if ( path != "-" )
     {
-        pairs_vec.emplace_back( std::max( vec[i - 1], vec[i] ), std::min( vec[i - 1], vec[i] ) );
+        MappedFile       file{ path };
+        std::string_view text{ file.view() };
+        parseNumbers( text.data(), text.data() + text.size(), true, numbers );
     }
-
-    return pairs_vec;
-}
-
-// Helper function for mergeSortPairs function
-std::vector<Pair> merge( std::vector<Pair>& vec1, std::vector<Pair>& vec2 )
-{
-    std::vector<Pair> vec;
-    vec.reserve( vec1.size() + vec2.size() );
-
-    while ( !vec1.empty() && !vec2.empty() )
+    else
     {
-        if ( vec1[0].first > vec2[0].first )
-        {
-            vec.emplace_back( vec2[0] );
-            vec2.erase( vec2.begin() );
-        }
-        else
+        std::vector<char> block( READ_BLOCK_SIZE );
+        std::size_t       kept{ 0 }; // Start of a number cut by the end of the previous block
+        while ( true )
         {
-            vec.emplace_back( vec1[0] );
-            vec1.erase( vec1.begin() );
+            ssize_t got{ read( STDIN_FILENO, block.data() + kept, block.size() - kept ) };
+            if ( got < 0 && errno == EINTR )
+                continue;
+            if ( got < 0 )
+                throw InvalidArgument( std::string{ "Could not read the standard input: " } + std::strerror( errno ) );
+
+            const char* end{ block.data() + kept + got };
+            const char* rest{ parseNumbers( block.data(), end, got == 0, numbers ) };
+            if ( got == 0 )
+                break;
+
+            // A "number" that fills a whole block cannot be valid
+            kept = static_cast<std::size_t>( end - rest );
+            if ( kept == block.size() )
+                throw InvalidArgument( "The list of numbers provided is not valid." );
+            std::memmove( block.data(), rest, kept );
         }
     }
 
-    while ( !vec1.empty() )
-    {
-        vec.emplace_back( vec1[0] );
-        vec1.erase( vec1.begin() );
-    }
-
-    while ( !vec2.empty() )
-    {
-        vec.emplace_back( vec2[0] );
-        vec2.erase( vec2.begin() );
-    }
-
-    return vec;
+    if ( numbers.empty() )
+        throw InvalidArgument( "No numbers to sort in " +
+                               ( path == "-" ? std::string{ "the standard input" } : path ) );
+    return numbers;
 }
 
-// Use merge sort to sort pair_vec according to their larger (first) element
-std::vector<Pair> mergeSortPairs( const std::vector<Pair>& pairs_vec )
+// The counts of every digit are taken in one pass over the elements, then each pass scatters the elements
+// into a buffer by one digit. A pass where all elements share the same digit would not move anything, so it
+// is skipped (with non-negative input below 2^22, only two passes remain)
+void PmergeMe::radixSort( std::vector<int>& vec )
 {
-    if ( pairs_vec.size() == 1 )
-        return pairs_vec;
-
-    auto mid_point_it{ pairs_vec.begin() + ( pairs_vec.size() / 2 ) };
-
-    std::vector<Pair> vec_half_1{ pairs_vec.begin(), mid_point_it };
-    std::vector<Pair> vec_half_2{ mid_point_it, pairs_vec.end() };
-
-    vec_half_1 = mergeSortPairs( vec_half_1 );
-    vec_half_2 = mergeSortPairs( vec_half_2 );
-
-    return merge( vec_half_1, vec_half_2 );
-}
-
-// Create a vector of indexes (0-based) based on Jacobsthal numbers, similar to FJ algorithm
-std::vector<std::size_t> createJacobsthalOrderVec( std::size_t size )
-{
-    // We hardcode cases of smaller size for efficiency
-    if ( size == 0 )
-        return {};
-    if ( size == 1 )
-        return { 0 };
-    if ( size == 2 )
-        return { 1, 0 };
-    if ( size == 3 )
-        return { 1, 0, 2 };
-
-    // Create a sequence of Jacobsthal numbers
-    std::vector<std::size_t> jacobsthal_vec{ 3, 5 };
-    while ( true )
-    {
-        std::size_t last_elem{ jacobsthal_vec[jacobsthal_vec.size() - 1] };
-        std::size_t second_last_elem{ jacobsthal_vec[jacobsthal_vec.size() - 2] };
-        std::size_t next_elem{ last_elem + ( 2 * second_last_elem ) };
-        // +1 because we will subtract an index later (first of the pairs has already been inserted)
-        if ( next_elem > size + 1 )
-            break;
-        jacobsthal_vec.push_back( next_elem );
-    }
-
-    // Create another vector (result) that fills the gaps in Jacobsthal numbers
-    std::vector<std::size_t> order_vec;
-    order_vec.reserve( size );
-    // Prev represents the previously added Jacobsthal number
-    // (starts with 1, because first of the pairs has already been inserted)
-    std::size_t prev{ 1 };
-
-    for ( std::size_t i{ 0 }; i < jacobsthal_vec.size(); ++i )
+    if ( vec.size() < RADIX_THRESHOLD )
     {
-        // Insert current Jacobsthal number
-        order_vec.push_back( jacobsthal_vec[i] );
-
-        // Insert the remaining indexes between current and previous Jacobsthal number
-        for ( std::size_t j{ jacobsthal_vec[i] - 1 }; j > prev; --j )
-            order_vec.push_back( j );
-
-        // Current becomes prev for the next loop
-        prev = jacobsthal_vec[i];
+        std::sort( vec.begin(), vec.end() );
+        return;
     }
 
-    // If the largest Jacobsthal number added is smaller than the required size, add the remainder
-    if ( size > order_vec.size() )
+    // Flipping the sign bit puts negative values first when keys are compared as unsigned
+    auto digit{ []( int value, unsigned pass ) {
+        return ( ( static_cast<std::uint32_t>( value ) ^ 0x80000000u ) >> ( pass * RADIX_BITS ) ) & ( RADIX_SIZE - 1 );
+    } };
+
+    PMERGEME_PHASES( phases );
+    PMERGEME_PHASE( phases, "counting" );
+    std::vector<std::size_t> counts( RADIX_PASSES * RADIX_SIZE );
+    for ( int value : vec )
+        for ( unsigned pass{ 0 }; pass < RADIX_PASSES; ++pass )
+            ++counts[pass * RADIX_SIZE + digit( value, pass )];
+
+    PMERGEME_PHASE( phases, "scattering" );
+    std::vector<int> buffer( vec.size() );
+    for ( unsigned pass{ 0 }; pass < RADIX_PASSES; ++pass )
     {
-        // +1 because we will subtract an index later (first of the pairs has already been inserted)
-        for ( std::size_t i{ size + 1 }; i > prev; --i )
-            order_vec.push_back( i );
+        std::size_t* count{ counts.data() + pass * RADIX_SIZE };
+        if ( count[digit( vec[0], pass )] == vec.size() )
+            continue;
+
+        // Counts become the index of the first element with every digit
+        std::size_t first{ 0 };
+        for ( std::size_t d{ 0 }; d < RADIX_SIZE; ++d )
+            first += std::exchange( count[d], first );
+
+        for ( int value : vec )
+            buffer[count[digit( value, pass )]++] = value;
+        vec.swap( buffer );
     }
-
-    // (just to be sure) For smaller N, make sure no extra Jacobsthal numbers have been added
-    while ( size < order_vec.size() )
-        order_vec.pop_back();
-
-    // Subtract 2 from each element (one for already inserted pair, another for 0 based index)
-    for ( auto& elem : order_vec )
-        elem -= 2;
-
-    return order_vec;
 }
 
-/*----------------Helper functions for list sorting----------------*/
+// List arena
 
-// Convert argv into std::list; throw on invalid input
-std::list<int> parseArgsList( int argc, char** argv )
+namespace
 {
-    std::list<int> lst;
-    (void)argc;
 
-    try
-    {
-        std::size_t remaining_pos;
-
-        for ( int i{ 1 }; argv[i]; ++i )
-        {
-            lst.push_back( std::stoi( argv[i], &remaining_pos ) );
-
-            // The arguments must be fully converted to (positive) integers to be considered valid
-            if ( remaining_pos != std::strlen( argv[i] ) || lst.back() < 0 )
-                throw std::exception();
-        }
-    }
-    catch ( const std::exception& )
-    {
-        throw PmergeMe::InvalidArgument( "The list of numbers provided as arguments is not valid." );
-    }
-
-    return lst;
-}
-
-// Create a list of pairs, first element is always >= the second; last odd element is not paired
-std::list<Pair> createSortedPairs( const std::list<int>& lst )
+// Memory resource that records the largest request it gets, and passes everything on to new and delete
+class RequestRecorder : public std::pmr::memory_resource
 {
-    std::list<Pair> pairs_list;
-
-    for ( size_t i{ 1 }; i < lst.size(); i += 2 )
+  public:
+    std::size_t largest() const
     {
-        // std::list does not have operator[], so we use iterator to access the index
-        auto prev{ std::next( lst.begin(), i - 1 ) };
-        auto cur{ std::next( lst.begin(), i ) };
-        pairs_list.emplace_back( std::max( *prev, *cur ), std::min( *prev, *cur ) );
+        return m_largest;
     }
 
-    return pairs_list;
-}
-
-// Helper function for mergeSortPairs function
-std::list<Pair> merge( std::list<Pair>& lst1, std::list<Pair>& lst2 )
-{
-    std::list<Pair> lst;
+  private:
+    std::size_t m_largest{ 0 };
 
-    while ( !lst1.empty() && !lst2.empty() )
+    void* do_allocate( std::size_t bytes, std::size_t alignment ) override
     {
-        if ( lst1.front().first > lst2.front().first )
-        {
-            lst.emplace_back( lst2.front() );
-            lst2.erase( lst2.begin() );
-        }
-        else
-        {
-            lst.emplace_back( lst1.front() );
-            lst1.erase( lst1.begin() );
-        }
+        m_largest = std::max( m_largest, bytes );
+        return std::pmr::new_delete_resource()->allocate( bytes, alignment );
     }
 
-    while ( !lst1.empty() )
+    void do_deallocate( void* p, std::size_t bytes, std::size_t alignment ) override
     {
-        lst.emplace_back( lst1.front() );
-        lst1.erase( lst1.begin() );
+        std::pmr::new_delete_resource()->deallocate( p, bytes, alignment );
     }
 
-    while ( !lst2.empty() )
+    bool do_is_equal( const std::pmr::memory_resource& other ) const noexcept override
     {
-        lst.emplace_back( lst2.front() );
-        lst2.erase( lst2.begin() );
+        return this == &other;
     }
+};
 
-    return lst;
-}
-
-// Use merge sort to sort pair_list according to their larger (first) element
-std::list<Pair> mergeSortPairs( const std::list<Pair>& pairs_list )
+// Bytes a std::pmr::list<int> asks for one node: the layout of nodes (links, element, padding, and any debug
+// fields) belongs to the standard library, so it is measured once on a list of one element
+std::size_t listNodeSize()
 {
-    if ( pairs_list.size() == 1 )
-        return pairs_list;
+    static const std::size_t node_size{ []() {
+        RequestRecorder recorder;
+        {
+            std::pmr::list<int> lst{ &recorder };
+            lst.push_back( 0 );
+        }
+        return recorder.largest();
+    }() };
+    return node_size;
+}
 
-    auto mid_point_it{ pairs_list.begin() };
-    std::advance( mid_point_it, pairs_list.size() / 2 );
+} // namespace
 
-    std::list<Pair> list_half_1{ pairs_list.begin(), mid_point_it };
-    std::list<Pair> list_half_2{ mid_point_it, pairs_list.end() };
+// The first block is sized for all the nodes, so that the whole list is built without going back to the
+// system; it is only a hint, since the arena asks for more blocks if it runs out
+PmergeMe::ListArena::ListArena( std::size_t node_count )
+    : std::pmr::monotonic_buffer_resource( std::max<std::size_t>( node_count, 1 ) * listNodeSize() )
+{
+}
 
-    list_half_1 = mergeSortPairs( list_half_1 );
-    list_half_2 = mergeSortPairs( list_half_2 );
+// Exception class
 
-    return merge( list_half_1, list_half_2 );
+PmergeMe::InvalidArgument::InvalidArgument( std::string_view error )
+    : m_error{ error }
+{
 }
 
-// Create a list of indexes (0-based) based on Jacobsthal numbers, similar to FJ algorithm
-std::list<std::size_t> createJacobsthalOrderList( std::size_t size )
+const char* PmergeMe::InvalidArgument::what() const noexcept
 {
-    // We hardcode cases of smaller size for efficiency
-    if ( size == 0 )
-        return {};
-    if ( size == 1 )
-        return { 0 };
-    if ( size == 2 )
-        return { 1, 0 };
-
-    // Create a sequence of Jacobsthal numbers
-    std::list<std::size_t> jacobsthal_list{ 3, 5 };
-    while ( true )
-    {
-        std::size_t last_elem{ jacobsthal_list.back() };
-        std::size_t second_last_elem{ *( std::prev( jacobsthal_list.end(), 2 ) ) };
-        std::size_t next_elem{ last_elem + ( 2 * second_last_elem ) };
-        // +1 because we will subtract an index later (first of the pairs has already been inserted)
-        if ( next_elem > size + 1 )
-            break;
-        jacobsthal_list.push_back( next_elem );
-    }
-
-    // Create another list (result) that fills the gaps in Jacobsthal numbers
-    std::list<std::size_t> order_list;
-    // Prev represents the previously added Jacobsthal number
-    // (starts with 1, because first of the pairs has already been inserted)
-    std::size_t prev{ 1 };
-
-    for ( auto cur : jacobsthal_list )
-    {
-        // Insert current Jacobsthal number
-        order_list.push_back( cur );
+    return m_error.c_str();
+}
 
-        // Insert the remaining indexes between current and previous Jacobsthal number
-        for ( std::size_t j{ cur - 1 }; j > prev; --j )
-            order_list.push_back( j );
+/*----------------Helper functions for sorting----------------*/
 
-        // Current becomes prev for the next loop
-        prev = cur;
-    }
+// Parse the whitespace-separated numbers of [begin, end) into numbers, validated like parseArgs()
+// Unless at_end, a number that reaches end may continue past it: return where it starts, so it is parsed again
+const char* parseNumbers( const char* begin, const char* end, bool at_end, std::vector<int>& numbers )
+{
+    auto is_space{ []( char c ) { return c == ' ' || ( c >= '\t' && c <= '\r' ); } };
 
-    // If the largest Jacobsthal number added is smaller than the required size, add the remainder
-    if ( size > order_list.size() )
+    while ( true )
     {
-        // +1 because we will subtract an index later (first of the pairs has already been inserted)
-        for ( std::size_t i{ size + 1 }; i > prev; --i )
-            order_list.push_back( i );
+        begin = std::find_if_not( begin, end, is_space );
+        if ( begin == end )
+            return end;
+
+        // std::stoi accepts a leading '+', std::from_chars does not
+        const char* digits{ *begin == '+' ? begin + 1 : begin };
+        int         value;
+        auto [number_end, error]{ std::from_chars( digits, end, value ) };
+        if ( number_end == end && !at_end )
+            return begin;
+
+        // Same rules as parseArgs(): fully converted, and not negative
+        if ( error != std::errc{} || ( number_end != end && !is_space( *number_end ) ) || value < 0 )
+            throw PmergeMe::InvalidArgument( "The list of numbers provided is not valid." );
+
+        numbers.push_back( value );
+        begin = number_end;
     }
-
-    // (just to be sure) For smaller N, make sure no extra Jacobsthal numbers have been added
-    while ( size < order_list.size() )
-        order_list.pop_back();
-
-    // Subtract 2 from each element (one for already inserted pair, another for 0 based index)
-    for ( auto& elem : order_list )
-        elem -= 2;
-
-    return order_list;
 }
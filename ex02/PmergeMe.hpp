@@ -1,19 +1,30 @@
 #ifndef PMERGEME_HPP
 #define PMERGEME_HPP
 
+#include "JacobsthalOrder.hpp"
+#include "MainChain.hpp"
+#include "Profiler.hpp"
+#include "SortKernels.hpp"
+#include "WorkStealingPool.hpp"
 #include <algorithm>
+#include <array>
+#include <atomic>
 #include <chrono>  // std::chrono functions in Timer
+#include <cstdint> // UINT32_MAX
 #include <cstring> // std::strlen
 #include <exception>
-#include <iomanip> // std::fixed, std::setprecision
+#include <functional> // std::less, std::invoke
+#include <iomanip>    // std::fixed, std::setprecision
 #include <iostream>
+#include <iterator> // std::iterator_traits, iterator category tags
 #include <list>
+#include <memory> // std::addressof
+#include <memory_resource>
 #include <string>
-#include <utility> // std::pair
+#include <type_traits>
+#include <utility> // std::pair, std::index_sequence
 #include <vector>
 
-using Pair = std::pair<int, int>;
-
 class PmergeMe
 {
   public:
@@ -27,6 +38,92 @@ class PmergeMe
     static std::vector<int> sortVector( int argc, char** argv );
     static std::list<int>   sortList( int argc, char** argv );
 
+    // Numbers of a file ("-" for the standard input), validated like the arguments of sortVector()
+    static std::vector<int> readNumbers( const std::string& path );
+
+    // LSD radix sort: no comparisons at all, for when only speed matters (ints of any sign)
+    static void radixSort( std::vector<int>& vec );
+
+    // Sort any container (std::vector, std::deque, std::list...) of any type with comp as "less than"
+    template <typename Container, typename Compare = std::less<>>
+    static void sort( Container& container, Compare comp = Compare{} );
+    // std::list is sorted by relinking its nodes, so elements are never copied
+    template <typename T, typename Alloc, typename Compare = std::less<>>
+    static void sort( std::list<T, Alloc>& lst, Compare comp = Compare{} );
+    // Sort [first, last); also works on plain arrays and pointer ranges
+    template <typename Iterator, typename Compare = std::less<>>
+    static void sortRange( Iterator first, Iterator last, Compare comp = Compare{} );
+
+    // Sort the N elements from first (N up to FIXED_SORT_MAX) with the same comparisons as sortRange(), but
+    // without allocating: for sorting a great many small groups. A small enough std::array is sorted this way
+    template <std::size_t N, typename RandomIt, typename Compare = std::less<>>
+    static void sortFixed( RandomIt first, Compare comp = Compare{} );
+    template <typename T, std::size_t N, typename Compare = std::less<>>
+    static void sort( std::array<T, N>& array, Compare comp = Compare{} );
+
+    // Sort records (a random-access container, or an array) by key( record ), which may also be a pointer to
+    // member: only compact ( key, index ) proxies are sorted, then every record is moved once, a cycle of the
+    // permutation at a time, so heavy payloads are never moved around during the sort. comp compares keys, and
+    // comparisons() counts those comparisons. The stable version keeps records with equal keys in their order
+    template <typename Container, typename KeyFn, typename Compare = std::less<>>
+    static void sortByKey( Container& records, KeyFn key, Compare comp = Compare{} );
+    template <typename Container, typename KeyFn, typename Compare = std::less<>>
+    static void stableSortByKey( Container& records, KeyFn key, Compare comp = Compare{} );
+
+    // The k smallest elements of container (all of them if it has fewer) in order, without sorting the rest. A
+    // knockout tournament, whose first round pairs up neighbours like merge-insertion does, finds the smallest in
+    // size - 1 comparisons; every next one then only replays the matches of the last winner, at most
+    // ceil( log2( size ) ) comparisons each. When Ford-Johnson on all the elements has the smaller worst case, they
+    // are sorted instead. Elements are only read, and the k results are copies
+    template <typename Container, typename Compare = std::less<>>
+    static auto smallest( const Container& container, std::size_t k, Compare comp = Compare{} );
+    template <typename Iterator, typename Compare = std::less<>>
+    static std::vector<typename std::iterator_traits<Iterator>::value_type>
+    smallestRange( Iterator first, Iterator last, std::size_t k, Compare comp = Compare{} );
+
+    // sortRange() also takes the allocation-free path of sortFixed() for ranges up to this size
+    static constexpr std::size_t FIXED_SORT_MAX{ 32 };
+
+    // Same as sort(), except that from ADAPTIVE_THRESHOLD elements, input that looks presorted is sorted by
+    // merging its natural runs; runs shorter than ADAPTIVE_MIN_RUN count as disorder, which is left to
+    // merge-insertion. Neither the probe (16 comparisons) nor the merges are bounded by comparisonBound(), and
+    // random input can pass the probe, so sort() and sortRange() never take this path
+    template <typename Container, typename Compare = std::less<>>
+    static void sortAdaptive( Container& container, Compare comp = Compare{} );
+    template <typename T, typename Alloc, typename Compare = std::less<>>
+    static void sortAdaptive( std::list<T, Alloc>& lst, Compare comp = Compare{} );
+
+    static constexpr std::size_t ADAPTIVE_THRESHOLD{ 256 };
+    static constexpr std::size_t ADAPTIVE_MIN_RUN{ 32 };
+
+    // Same as sortRange() on a random-access range, with the work spread over pool; comp is called from
+    // several threads at once. Comparisons are no longer minimal, see parallelMergeInsertionOrder(), and
+    // comparisons() does not count them (the SIMD kernels on int compare without comp)
+    template <typename RandomIt, typename Compare = std::less<>>
+    static void sortParallel( RandomIt first, RandomIt last, WorkStealingPool& pool, Compare comp = Compare{} );
+
+    // sortParallel() sorts shorter ranges serially, and splits the work into tasks of about PARALLEL_GRAIN items
+    static constexpr std::size_t PARALLEL_THRESHOLD{ 1 << 15 };
+    static constexpr std::size_t PARALLEL_GRAIN{ 1 << 13 };
+
+    // Comparisons made by the last sort of a random-access range (or smallest()) on the calling thread, the
+    // Ford-Johnson worst case for size elements, and the worst case of smallest() taking k of size elements
+    static std::size_t comparisons();
+    static std::size_t comparisonBound( std::size_t size );
+    static std::size_t selectionBound( std::size_t size, std::size_t k );
+
+    // Memory for the nodes of a std::pmr::list<int> of node_count elements: taken from the system in one block
+    // up front and given back in one go when the arena is destroyed (freeing a node does nothing)
+    class ListArena : public std::pmr::monotonic_buffer_resource
+    {
+      public:
+        // OCF (memory resources cannot be copied)
+        explicit ListArena( std::size_t node_count );
+        ListArena( const ListArena& other )            = delete;
+        ListArena& operator=( const ListArena& other ) = delete;
+        ~ListArena() override                          = default;
+    };
+
     // Exception class
     class InvalidArgument : public std::exception
     {
@@ -59,34 +156,155 @@ class PmergeMe
             return std::chrono::duration_cast<MicroSecond>( Clock::now() - m_beginning ).count();
         }
     };
+
+  private:
+    // One count per thread, so that sorts running at the same time do not race on it
+    inline static thread_local std::size_t s_comparisons{ 0 };
+
+    // Dispatch on iterator category: random-access ranges are sorted by index, the others through a std::list
+    // With adaptive, presorted input is merged from its runs, see sortAdaptive()
+    template <typename RandomIt, typename Compare>
+    static void sortRange( RandomIt first, RandomIt last, Compare& comp, bool adaptive,
+                           std::random_access_iterator_tag );
+    template <typename ForwardIt, typename Compare>
+    static void sortRange( ForwardIt first, ForwardIt last, Compare& comp, bool adaptive,
+                           std::forward_iterator_tag );
+
+    template <typename RandomIt, typename KeyFn, typename Compare>
+    static void sortRangeByKey( RandomIt first, RandomIt last, KeyFn& key, Compare& comp, bool stable );
+
+    // Worst case of the tournament of smallest(): size - 1 comparisons, then ceil( log2( size ) ) per next element
+    static std::size_t tournamentBound( std::size_t size, std::size_t k );
 };
 
-/*----------------Helper functions for vector sorting----------------*/
+/*----------------Helper functions for sorting----------------*/
+
+// Convert argv into a container of int (std::vector, std::list...); throw on invalid input
+// The numbers are appended to container, which can come with its allocator
+template <typename Container>
+Container parseArgs( int argc, char** argv, Container container = Container{} );
 
-// Convert argv into std::vector; throw on invalid input
-std::vector<int> parseArgsVec( int argc, char** argv );
+// Parse the whitespace-separated numbers of [begin, end) into numbers, validated like parseArgs()
+// Unless at_end, a number that reaches end may continue past it: return where it starts, so it is parsed again
+const char* parseNumbers( const char* begin, const char* end, bool at_end, std::vector<int>& numbers );
 
-// Create a vector of pairs, first element is always >= the second; last odd element is not paired
-std::vector<Pair> createSortedPairs( const std::vector<int>& vec );
+/*----------------Helper functions for random-access sorting----------------*/
 
-// Use merge sort to sort pair_vec according to their larger (first) element
-std::vector<Pair> mergeSortPairs( const std::vector<Pair>& pairs_vec );
+// Ford-Johnson sort of the size elements from first, compared with less( a, b )
+template <typename RandomIt, typename Less>
+void mergeInsertionSort( RandomIt first, std::size_t size, Less& less );
 
-// Create a vector of indexes (0-based) based on Jacobsthal numbers, similar to FJ algorithm
-std::vector<std::size_t> createJacobsthalOrderVec( std::size_t size );
+// Recursive Ford-Johnson sort of the elements ids[0], ids[1]... compared with less( id_a, id_b )
+// Return the positions in ids in sorted order
+template <typename Less>
+std::vector<std::size_t> fordJohnsonOrder( const std::vector<std::size_t>& ids, Less& less );
+
+// Same for exactly N elements ids[0..N-1], with every array on the stack: write the positions in order[0..N-1]
+template <std::size_t N, typename Less>
+void fixedFordJohnsonOrder( const std::size_t* ids, Less& less, std::size_t* order );
+
+// Same for a size only known at run time, up to PmergeMe::FIXED_SORT_MAX: calls the matching instantiation
+template <typename Less>
+void fixedFordJohnsonOrder( std::size_t size, const std::size_t* ids, Less& less, std::size_t* order );
+
+// Move the elements of [first, first + size) so that the one at order[i] ends up at i, a cycle at a time
+// without any buffer, fetching the next element of the cycle ahead; order is used up
+template <typename RandomIt>
+void applyOrder( RandomIt first, std::size_t* order, std::size_t size );
+
+/*----------------Helper functions for selection----------------*/
+
+// The k smallest of elements 0..size-1 compared with less( a, b ), in order (1 <= k <= size), from a knockout
+// tournament kept as a tree of winners: node j (from 1) plays the winners of nodes 2j and 2j + 1, and nodes from
+// size on are the elements themselves, so neighbours meet in the first round. Winners are stored as Id
+template <typename Id, typename Less>
+std::vector<std::size_t> tournamentOrder( std::size_t size, std::size_t k, Less& less );
+
+/*----------------Helper functions for adaptive sorting----------------*/
+
+// Whether [first, first + size) looks mostly ascending, mostly descending, or made of a few long runs, from 16
+// comparisons of neighbours spread over it (size must be at least 2)
+template <typename ForwardIt, typename Less>
+bool looksPresorted( ForwardIt first, std::size_t size, Less& less );
+
+// Length of the run at the start of [first, first + size): ascending, or strictly descending, in which case it
+// is reversed in place
+template <typename RandomIt, typename Less>
+std::size_t countRun( RandomIt first, std::size_t size, Less& less );
+
+// Merge runs off the top of a stack of run_sizes until every run is longer than the next one, and than the next
+// two together (TimSort's rules, which keep merges balanced), or down to one run if force
+// merge_at( k ) merges runs k and k + 1 of the caller's own stack
+template <typename MergeAt>
+void collapseRuns( std::vector<std::size_t>& run_sizes, bool force, const MergeAt& merge_at );
+
+// Number of elements at the front of [first, first + size) for which pred holds (it must hold on a prefix),
+// searched with growing steps, so it takes about 2 log2( result ) calls
+template <typename RandomIt, typename Predicate>
+std::size_t gallopForward( RandomIt first, std::size_t size, const Predicate& pred );
+
+// Where the suffix of [first, first + size) for which pred holds starts, searched from the end
+template <typename RandomIt, typename Predicate>
+std::size_t gallopBackward( RandomIt first, std::size_t size, const Predicate& pred );
+
+// Stable merge of the sorted runs [first, first + left_size) and the right_size elements after it, through
+// buffer; galloping makes a run that is mostly ahead of the other cost a logarithmic number of comparisons
+template <typename RandomIt, typename Less>
+void mergeAdjacentRuns( RandomIt first, std::size_t left_size, std::size_t right_size, Less& less,
+                        std::vector<typename std::iterator_traits<RandomIt>::value_type>& buffer );
+
+// Sort by merging natural runs: descending runs are reversed, and stretches of short runs are sorted by
+// merge-insertion first
+template <typename RandomIt, typename Less>
+void mergeRuns( RandomIt first, std::size_t size, Less& less );
+
+// Same for a std::list, by splicing: runs are merged with std::list::merge(), which cannot gallop
+template <typename T, typename Alloc, typename Compare>
+void mergeRuns( std::list<T, Alloc>& lst, Compare& comp );
 
 /*----------------Helper functions for list sorting----------------*/
 
-// Convert argv into std::vector; throw on invalid input
-std::list<int> parseArgsList( int argc, char** argv );
+// Merge-insertion sort of lst that only relinks its nodes (splice), so elements are never copied or moved
+template <typename T, typename Alloc, typename Compare>
+void mergeInsertionList( std::list<T, Alloc>& lst, Compare& comp );
+
+// In one pass, order each pair of adjacent elements of lst so that the greater comes first
+// A last odd element is left where it is
+template <typename T, typename Alloc, typename Compare>
+void createSortedPairs( std::list<T, Alloc>& lst, Compare& comp );
+
+// Use merge sort to sort the pair_count pairs of pairs_list (two adjacent nodes each) by their first element
+template <typename T, typename Alloc, typename Compare>
+void mergeSortPairs( std::list<T, Alloc>& pairs_list, std::size_t pair_count, Compare& comp );
+
+/*----------------Helper functions for parallel sorting----------------*/
+
+// Order of packed keys (see SortKernels.hpp): parallelMergeSort() sorts and merges those with the SIMD kernels
+struct PackedKeyLess
+{
+    bool operator()( std::int64_t a, std::int64_t b, std::size_t& ) const
+    {
+        return a < b;
+    }
+};
+
+// Run fn( begin, end ) on pool for consecutive chunks of [0, count) of grain items, and wait for all of them
+template <typename Function>
+void parallelFor( WorkStealingPool& pool, std::size_t count, std::size_t grain, const Function& fn );
 
-// Create a list of pairs, first element is always >= the second; last odd element is not paired
-std::list<Pair> createSortedPairs( const std::list<int>& lst );
+// Stable merge sort of items on pool: chunks are sorted on their own, then merged a round at a time with
+// every merge split into equal parts (merge path); less( a, b, count ) also counts element comparisons
+template <typename Item, typename Less>
+void parallelMergeSort( std::vector<Item>& items, const Less& less, WorkStealingPool& pool,
+                        std::atomic<std::size_t>& comparisons );
 
-// Use merge sort to sort pair_vec according to their larger (first) element
-std::list<Pair> mergeSortPairs( const std::list<Pair>& pairs_vec );
+// Merge-insertion order of elements 0..size-1 compared with less( a, b ), with every phase spread over pool
+// If the elements are the ints int_values[0..size-1] compared with <, pairs are sorted with the SIMD kernels
+template <typename Less>
+std::vector<std::size_t> parallelMergeInsertionOrder( std::size_t size, const Less& less, WorkStealingPool& pool,
+                                                      std::atomic<std::size_t>& comparisons,
+                                                      const int*                int_values = nullptr );
 
-// Create a list of indexes (0-based) based on Jacobsthal numbers, similar to FJ algorithm
-std::list<std::size_t> createJacobsthalOrderList( std::size_t size );
+#include "PmergeMe.tpp"
 
 #endif /* PMERGEME_HPP */
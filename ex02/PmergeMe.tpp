@@ -0,0 +1,1278 @@
+#ifndef PMERGEME_TPP
+#define PMERGEME_TPP
+
+// Template definitions for PmergeMe.hpp (included at its end)
+
+template <typename Container, typename Compare>
+void PmergeMe::sort( Container& container, Compare comp )
+{
+    sortRange( std::begin( container ), std::end( container ), comp );
+}
+
+template <typename T, typename Alloc, typename Compare>
+void PmergeMe::sort( std::list<T, Alloc>& lst, Compare comp )
+{
+    mergeInsertionList( lst, comp );
+}
+
+template <typename Iterator, typename Compare>
+void PmergeMe::sortRange( Iterator first, Iterator last, Compare comp )
+{
+    sortRange( first, last, comp, false, typename std::iterator_traits<Iterator>::iterator_category{} );
+}
+
+template <typename Container, typename Compare>
+void PmergeMe::sortAdaptive( Container& container, Compare comp )
+{
+    sortRange( std::begin( container ), std::end( container ), comp, true,
+               typename std::iterator_traits<decltype( std::begin( container ) )>::iterator_category{} );
+}
+
+template <typename T, typename Alloc, typename Compare>
+void PmergeMe::sortAdaptive( std::list<T, Alloc>& lst, Compare comp )
+{
+    if ( lst.size() >= ADAPTIVE_THRESHOLD && looksPresorted( lst.begin(), lst.size(), comp ) )
+        mergeRuns( lst, comp );
+    else
+        mergeInsertionList( lst, comp );
+}
+
+template <std::size_t N, typename RandomIt, typename Compare>
+void PmergeMe::sortFixed( RandomIt first, Compare comp )
+{
+    static_assert( N <= FIXED_SORT_MAX, "sortFixed() is for at most FIXED_SORT_MAX elements" );
+
+    std::size_t                comparisons{ 0 };
+    std::array<std::size_t, N> ids{};
+    for ( std::size_t i{ 0 }; i < N; ++i )
+        ids[i] = i;
+
+    auto less{ [&]( std::size_t id_a, std::size_t id_b ) {
+        ++comparisons;
+        return comp( first[id_a], first[id_b] );
+    } };
+
+    std::array<std::size_t, N> order{};
+    fixedFordJohnsonOrder<N>( ids.data(), less, order.data() );
+    applyOrder( first, order.data(), N );
+
+    s_comparisons = comparisons;
+}
+
+template <typename T, std::size_t N, typename Compare>
+void PmergeMe::sort( std::array<T, N>& array, Compare comp )
+{
+    if constexpr ( N <= FIXED_SORT_MAX )
+        sortFixed<N>( array.begin(), comp );
+    else
+        sortRange( array.begin(), array.end(), comp );
+}
+
+template <typename Container, typename KeyFn, typename Compare>
+void PmergeMe::sortByKey( Container& records, KeyFn key, Compare comp )
+{
+    sortRangeByKey( std::begin( records ), std::end( records ), key, comp, false );
+}
+
+template <typename Container, typename KeyFn, typename Compare>
+void PmergeMe::stableSortByKey( Container& records, KeyFn key, Compare comp )
+{
+    sortRangeByKey( std::begin( records ), std::end( records ), key, comp, true );
+}
+
+template <typename Container, typename Compare>
+auto PmergeMe::smallest( const Container& container, std::size_t k, Compare comp )
+{
+    return smallestRange( std::begin( container ), std::end( container ), k, comp );
+}
+
+template <typename Iterator, typename Compare>
+std::vector<typename std::iterator_traits<Iterator>::value_type>
+PmergeMe::smallestRange( Iterator first, Iterator last, std::size_t k, Compare comp )
+{
+    using Value = typename std::iterator_traits<Iterator>::value_type;
+    constexpr bool random_access{ std::is_base_of_v<std::random_access_iterator_tag,
+                                                    typename std::iterator_traits<Iterator>::iterator_category> };
+
+    // Without random access, the tournament is played on the addresses of the elements
+    std::vector<const Value*> addresses;
+    if constexpr ( !random_access )
+        for ( auto it{ first }; it != last; ++it )
+            addresses.push_back( std::addressof( *it ) );
+    auto element{ [&]( std::size_t id ) -> const Value& {
+        if constexpr ( random_access )
+            return first[id];
+        else
+            return *addresses[id];
+    } };
+
+    auto size{ static_cast<std::size_t>( std::distance( first, last ) ) };
+    k = std::min( k, size );
+
+    std::size_t        comparisons{ 0 };
+    std::vector<Value> result;
+    if ( k > 0 && tournamentBound( size, k ) > comparisonBound( size ) )
+    {
+        auto less{ [&]( const Value& a, const Value& b ) {
+            ++comparisons;
+            return comp( a, b );
+        } };
+        result.assign( first, last );
+        mergeInsertionSort( result.begin(), size, less );
+        result.resize( k );
+    }
+    else if ( k > 0 )
+    {
+        auto less_id{ [&]( std::size_t id_a, std::size_t id_b ) {
+            ++comparisons;
+            return comp( element( id_a ), element( id_b ) );
+        } };
+        result.reserve( k );
+        // Ids of the players take half the memory when they fit in 32 bits
+        std::vector<std::size_t> order{ size <= UINT32_MAX ? tournamentOrder<std::uint32_t>( size, k, less_id )
+                                                           : tournamentOrder<std::size_t>( size, k, less_id ) };
+        for ( auto id : order )
+            result.push_back( element( id ) );
+    }
+
+    s_comparisons = comparisons;
+    return result;
+}
+
+template <typename RandomIt, typename KeyFn, typename Compare>
+void PmergeMe::sortRangeByKey( RandomIt first, RandomIt last, KeyFn& key, Compare& comp, bool stable )
+{
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+    using Key   = std::decay_t<std::invoke_result_t<KeyFn&, Value&>>;
+    using Proxy = std::pair<Key, std::size_t>; // Key, then index of the record
+    static_assert( std::is_base_of_v<std::random_access_iterator_tag,
+                                     typename std::iterator_traits<RandomIt>::iterator_category>,
+                   "sortByKey() needs random-access iterators" );
+
+    auto               size{ static_cast<std::size_t>( last - first ) };
+    std::vector<Proxy> proxies;
+    proxies.reserve( size );
+    for ( std::size_t i{ 0 }; i < size; ++i )
+        proxies.emplace_back( std::invoke( key, first[i] ), i );
+
+    // Equal keys are told apart by index when stable, which costs a second comparison
+    std::size_t comparisons{ 0 };
+    auto        less{ [&]( const Proxy& a, const Proxy& b ) {
+        ++comparisons;
+        if ( comp( a.first, b.first ) )
+            return true;
+        if ( !stable )
+            return false;
+        ++comparisons;
+        return !comp( b.first, a.first ) && a.second < b.second;
+    } };
+    sortRange( proxies.begin(), proxies.end(), less );
+
+    PMERGEME_PHASES( phases );
+    PMERGEME_PHASE( phases, "reordering" );
+    std::vector<std::size_t> order( size );
+    for ( std::size_t i{ 0 }; i < size; ++i )
+        order[i] = proxies[i].second;
+    applyOrder( first, order.data(), size );
+
+    s_comparisons = comparisons;
+}
+
+template <typename RandomIt, typename Compare>
+void PmergeMe::sortRange( RandomIt first, RandomIt last, Compare& comp, bool adaptive,
+                          std::random_access_iterator_tag )
+{
+    std::size_t comparisons{ 0 };
+    auto        size{ static_cast<std::size_t>( last - first ) };
+    auto        less{ [&]( auto&& a, auto&& b ) {
+        ++comparisons;
+        return comp( a, b );
+    } };
+
+    // Presorted input is merged from its natural runs, with merge-insertion only for its disordered parts
+    if ( adaptive && size >= ADAPTIVE_THRESHOLD && looksPresorted( first, size, less ) )
+        mergeRuns( first, size, less );
+    else
+        mergeInsertionSort( first, size, less );
+
+    s_comparisons = comparisons;
+}
+
+template <typename ForwardIt, typename Compare>
+void PmergeMe::sortRange( ForwardIt first, ForwardIt last, Compare& comp, bool adaptive, std::forward_iterator_tag )
+{
+    using Value = typename std::iterator_traits<ForwardIt>::value_type;
+
+    // Without random access, sort the elements as a std::list and move them back
+    std::list<Value> lst( std::make_move_iterator( first ), std::make_move_iterator( last ) );
+    if ( adaptive )
+        sortAdaptive( lst, comp );
+    else
+        sort( lst, comp );
+    std::move( lst.begin(), lst.end(), first );
+}
+
+template <typename RandomIt, typename Compare>
+void PmergeMe::sortParallel( RandomIt first, RandomIt last, WorkStealingPool& pool, Compare comp )
+{
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+    static_assert( std::is_base_of_v<std::random_access_iterator_tag,
+                                     typename std::iterator_traits<RandomIt>::iterator_category>,
+                   "sortParallel() needs random-access iterators" );
+
+    auto size{ static_cast<std::size_t>( last - first ) };
+    if ( size < PARALLEL_THRESHOLD || pool.size() < 2 )
+    {
+        sortRange( first, last, comp );
+        return;
+    }
+
+    // Plain ints in contiguous memory, compared with <, can go through the SIMD kernels
+    const int* int_values{ nullptr };
+    if constexpr ( std::is_same_v<Value, int> &&
+                   ( std::is_same_v<Compare, std::less<>> || std::is_same_v<Compare, std::less<int>> ) &&
+                   ( std::is_same_v<RandomIt, int*> || std::is_same_v<RandomIt, std::vector<int>::iterator> ) )
+        int_values = &*first;
+
+    PMERGEME_PHASES( phases );
+    PMERGEME_PHASE( phases, "merge-insertion" );
+    std::atomic<std::size_t> comparisons{ 0 };
+    auto less{ [&]( std::size_t id_a, std::size_t id_b ) { return comp( first[id_a], first[id_b] ); } };
+    std::vector<std::size_t> order{ parallelMergeInsertionOrder( size, less, pool, comparisons, int_values ) };
+
+    // Gather the elements in that order, then move them back
+    PMERGEME_PHASE( phases, "reordering" );
+    std::vector<Value> sorted( size );
+    parallelFor( pool, size, PARALLEL_GRAIN, [&]( std::size_t begin, std::size_t end ) {
+        for ( std::size_t i{ begin }; i < end; ++i )
+            sorted[i] = std::move( first[order[i]] );
+    } );
+    parallelFor( pool, size, PARALLEL_GRAIN, [&]( std::size_t begin, std::size_t end ) {
+        std::move( sorted.begin() + begin, sorted.begin() + end, first + begin );
+    } );
+
+    s_comparisons = comparisons;
+}
+
+/*----------------Helper functions for sorting----------------*/
+
+// Only some containers can reserve memory up front
+template <typename Container, typename = void>
+struct HasReserve : std::false_type
+{
+};
+
+template <typename Container>
+struct HasReserve<Container, std::void_t<decltype( std::declval<Container&>().reserve( 0 ) )>> : std::true_type
+{
+};
+
+// Convert argv into a container of int (std::vector, std::list...); throw on invalid input
+template <typename Container>
+Container parseArgs( int argc, char** argv, Container container )
+{
+    PMERGEME_PHASES( phases );
+    PMERGEME_PHASE( phases, "parsing" );
+
+    if constexpr ( HasReserve<Container>::value )
+        container.reserve( argc - 1 );
+    else
+        (void)argc;
+
+    try
+    {
+        std::size_t remaining_pos;
+
+        for ( int i{ 1 }; argv[i]; ++i )
+        {
+            container.push_back( std::stoi( argv[i], &remaining_pos ) );
+
+            // The arguments must be fully converted to (positive) integers to be considered valid
+            if ( remaining_pos != std::strlen( argv[i] ) || container.back() < 0 )
+                throw std::exception();
+        }
+    }
+    catch ( const std::exception& )
+    {
+        throw PmergeMe::InvalidArgument( "The list of numbers provided as arguments is not valid." );
+    }
+
+    return container;
+}
+
+/*----------------Helper functions for random-access sorting----------------*/
+
+// Ford-Johnson sort of the size elements from first, compared with less( a, b )
+template <typename RandomIt, typename Less>
+void mergeInsertionSort( RandomIt first, std::size_t size, Less& less )
+{
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+
+    // Sort the indexes of the elements, then gather the elements in that order
+    auto less_id{ [&]( std::size_t id_a, std::size_t id_b ) { return less( first[id_a], first[id_b] ); } };
+
+    // Small ranges are sorted on the stack, the same way as sortFixed()
+    if ( size <= PmergeMe::FIXED_SORT_MAX )
+    {
+        std::array<std::size_t, PmergeMe::FIXED_SORT_MAX> ids{};
+        std::array<std::size_t, PmergeMe::FIXED_SORT_MAX> order{};
+        for ( std::size_t i{ 0 }; i < size; ++i )
+            ids[i] = i;
+
+        fixedFordJohnsonOrder( size, ids.data(), less_id, order.data() );
+        applyOrder( first, order.data(), size );
+        return;
+    }
+
+    PMERGEME_PHASES( phases );
+    std::vector<std::size_t> ids( size );
+    for ( std::size_t i{ 0 }; i < size; ++i )
+        ids[i] = i;
+
+    PMERGEME_PHASE( phases, "merge-insertion" );
+    std::vector<std::size_t> order{ fordJohnsonOrder( ids, less_id ) };
+
+    PMERGEME_PHASE( phases, "reordering" );
+    std::vector<Value> sorted;
+    sorted.reserve( order.size() );
+    for ( auto id : order )
+        sorted.push_back( std::move( first[id] ) );
+    std::move( sorted.begin(), sorted.end(), first );
+}
+
+// Recursive Ford-Johnson (merge-insertion) sort of the elements ids[0], ids[1]... compared with less( id_a, id_b )
+// Return the positions in ids in sorted order
+template <typename Less>
+std::vector<std::size_t> fordJohnsonOrder( const std::vector<std::size_t>& ids, Less& less )
+{
+    // Small enough to be sorted on the stack, which makes the same comparisons
+    if ( ids.size() <= PmergeMe::FIXED_SORT_MAX )
+    {
+        std::vector<std::size_t> order( ids.size() );
+        fixedFordJohnsonOrder( ids.size(), ids.data(), less, order.data() );
+        return order;
+    }
+
+    auto less_pos{ [&]( std::size_t pos_a, std::size_t pos_b ) { return less( ids[pos_a], ids[pos_b] ); } };
+
+    // Create pairs (leave out the odd one for now): larger_pos[p] is the greater of pair p
+    PMERGEME_PHASES( phases );
+    PMERGEME_PHASE( phases, "pairing" );
+    std::size_t              pair_count{ ids.size() / 2 };
+    std::vector<std::size_t> larger_pos( pair_count );
+    std::vector<std::size_t> smaller_pos( pair_count );
+    std::vector<std::size_t> larger_ids( pair_count );
+
+    for ( std::size_t p{ 0 }; p < pair_count; ++p )
+    {
+        bool swapped{ less_pos( 2 * p + 1, 2 * p ) };
+        larger_pos[p]  = swapped ? 2 * p : 2 * p + 1;
+        smaller_pos[p] = swapped ? 2 * p + 1 : 2 * p;
+        larger_ids[p]  = ids[larger_pos[p]];
+    }
+
+    // Sort the pairs by their greater element, recursively with the same algorithm
+    PMERGEME_PHASE( phases, "pair sort" );
+    std::vector<std::size_t> pair_order{ fordJohnsonOrder( larger_ids, less ) };
+
+    // Main chain: the smaller of the first pair, then all greaters of the pairs (already sorted)
+    // It is kept in small blocks, so that an insertion does not have to shift the whole chain
+    PMERGEME_PHASE( phases, "insertion" );
+    std::vector<std::size_t> initial_chain;
+    initial_chain.reserve( pair_count + 1 );
+    initial_chain.push_back( smaller_pos[pair_order[0]] );
+    for ( auto p : pair_order )
+        initial_chain.push_back( larger_pos[p] );
+    MainChain chain{ initial_chain, ids.size() };
+
+    // Remaining elements; partner[k] is the greater of pending[k]
+    std::vector<std::size_t> pending;
+    std::vector<std::size_t> partner;
+    pending.reserve( pair_count );
+    partner.reserve( pair_count );
+    for ( std::size_t k{ 1 }; k < pair_count; ++k )
+    {
+        pending.push_back( smaller_pos[pair_order[k]] );
+        partner.push_back( larger_pos[pair_order[k]] );
+    }
+    // Don't forget the left out odd (it can go anywhere in the chain)
+    if ( ids.size() % 2 != 0 )
+        pending.push_back( ids.size() - 1 );
+
+    // FJ algorithm uses Jacobsthal numbers to determine the order of insertion (of all the pending elements)
+    for ( auto idx : JacobsthalOrder{ pending.size() } )
+    {
+        // Only the part of the chain before its partner can hold the element, which is what keeps the
+        // searches (and therefore the number of comparisons) minimal
+        std::size_t bound{ idx < partner.size() ? chain.rankOf( partner[idx] ) : chain.size() };
+
+        std::size_t insertion_rank{ chain.lowerBound(
+            bound, [&]( std::size_t pos ) { return less_pos( pos, pending[idx] ); } ) };
+
+        chain.insert( insertion_rank, pending[idx] );
+    }
+
+    return chain.flatten();
+}
+
+// Same as fordJohnsonOrder() for exactly N elements: the main chain is built in order itself, and an insertion
+// shifts the end of it, which is cheap at this size
+template <std::size_t N, typename Less>
+void fixedFordJohnsonOrder( const std::size_t* ids, Less& less, std::size_t* order )
+{
+    if constexpr ( N < 2 )
+    {
+        if constexpr ( N == 1 )
+            order[0] = 0;
+    }
+    else
+    {
+        constexpr std::size_t pair_count{ N / 2 };
+        constexpr std::size_t pending_count{ pair_count - 1 + N % 2 };
+
+        auto less_pos{ [&]( std::size_t pos_a, std::size_t pos_b ) { return less( ids[pos_a], ids[pos_b] ); } };
+
+        // Create pairs (leave out the odd one for now), then sort them by their greater element
+        std::array<std::size_t, pair_count> larger_pos{};
+        std::array<std::size_t, pair_count> smaller_pos{};
+        std::array<std::size_t, pair_count> larger_ids{};
+        for ( std::size_t p{ 0 }; p < pair_count; ++p )
+        {
+            bool swapped{ less_pos( 2 * p + 1, 2 * p ) };
+            larger_pos[p]  = swapped ? 2 * p : 2 * p + 1;
+            smaller_pos[p] = swapped ? 2 * p + 1 : 2 * p;
+            larger_ids[p]  = ids[larger_pos[p]];
+        }
+
+        std::array<std::size_t, pair_count> pair_order{};
+        fixedFordJohnsonOrder<pair_count>( larger_ids.data(), less, pair_order.data() );
+
+        // Main chain: the smaller of the first pair, then all greaters of the pairs; partner_rank[k] is the rank
+        // of the greater of pending element k
+        std::array<std::size_t, pair_count - 1> partner_rank{};
+        std::size_t                             chain_size{ pair_count + 1 };
+        order[0] = smaller_pos[pair_order[0]];
+        for ( std::size_t k{ 0 }; k < pair_count; ++k )
+        {
+            order[k + 1] = larger_pos[pair_order[k]];
+            if ( k > 0 )
+                partner_rank[k - 1] = k + 1;
+        }
+
+        for ( auto idx : JacobsthalOrder{ pending_count } )
+        {
+            bool        has_partner{ idx + 1 < pair_count };
+            std::size_t element{ has_partner ? smaller_pos[pair_order[idx + 1]] : N - 1 };
+            std::size_t bound{ has_partner ? partner_rank[idx] : chain_size };
+
+            auto rank{ static_cast<std::size_t>(
+                std::lower_bound( order, order + bound, element, less_pos ) - order ) };
+            std::move_backward( order + rank, order + chain_size, order + chain_size + 1 );
+            order[rank] = element;
+            ++chain_size;
+
+            for ( auto& partner : partner_rank )
+                if ( partner >= rank )
+                    ++partner;
+        }
+    }
+}
+
+// One instantiation of fixedFordJohnsonOrder() per size, looked up by size
+template <typename Less, std::size_t... Sizes>
+void fixedFordJohnsonOrder( std::size_t size, const std::size_t* ids, Less& less, std::size_t* order,
+                            std::index_sequence<Sizes...> )
+{
+    using Sorter = void ( * )( const std::size_t*, Less&, std::size_t* );
+    static constexpr Sorter sorters[]{ &fixedFordJohnsonOrder<Sizes, Less>... };
+    sorters[size]( ids, less, order );
+}
+
+template <typename Less>
+void fixedFordJohnsonOrder( std::size_t size, const std::size_t* ids, Less& less, std::size_t* order )
+{
+    fixedFordJohnsonOrder( size, ids, less, order, std::make_index_sequence<PmergeMe::FIXED_SORT_MAX + 1>{} );
+}
+
+template <typename RandomIt>
+void applyOrder( RandomIt first, std::size_t* order, std::size_t size )
+{
+    for ( std::size_t start{ 0 }; start < size; ++start )
+    {
+        if ( order[start] == start )
+            continue;
+
+        // Follow the cycle through start: every element is moved once, and marked done in order. The walk jumps
+        // all over the range, so the element after next is prefetched while next is moved
+        auto        carried{ std::move( first[start] ) };
+        std::size_t i{ start };
+        while ( order[i] != start )
+        {
+            std::size_t next{ order[i] };
+            if constexpr ( std::is_lvalue_reference_v<typename std::iterator_traits<RandomIt>::reference> )
+                __builtin_prefetch( std::addressof( first[order[next]] ) );
+            first[i] = std::move( first[next] );
+            order[i] = i;
+            i        = next;
+        }
+        first[i] = std::move( carried );
+        order[i] = i;
+    }
+}
+
+/*----------------Helper functions for selection----------------*/
+
+// The k smallest of elements 0..size-1 compared with less( a, b ), in order (1 <= k <= size), from a knockout
+// tournament kept as a tree of winners: node j (from 1) plays the winners of nodes 2j and 2j + 1, and nodes from
+// size on are the elements themselves, so neighbours meet in the first round
+template <typename Id, typename Less>
+std::vector<std::size_t> tournamentOrder( std::size_t size, std::size_t k, Less& less )
+{
+    PMERGEME_PHASES( phases );
+    PMERGEME_PHASE( phases, "tournament" );
+
+    // winners[j] is the winner of node j; winners[0] is unused, and stays the only winner if size is 1
+    std::vector<Id>   winners( size, 0 );
+    std::vector<bool> taken( size, false );
+    auto winner_of{ [&]( std::size_t node ) -> std::size_t { return node >= size ? node - size : winners[node]; } };
+
+    // Taken elements have lost every match already; a node whose elements are all taken keeps a taken winner
+    auto play{ [&]( std::size_t node ) {
+        std::size_t a{ winner_of( 2 * node ) };
+        std::size_t b{ winner_of( 2 * node + 1 ) };
+        if ( taken[a] || taken[b] )
+            winners[node] = static_cast<Id>( taken[a] ? b : a );
+        else
+            winners[node] = static_cast<Id>( less( b, a ) ? b : a );
+    } };
+
+    // Nothing is taken yet in the first pass. Its matches are coin flips on random input, so the winner is picked
+    // with a mask rather than a branch; the first round, between neighbours, needs no lookup of the players
+    auto pick{ [&]( std::size_t a, std::size_t b ) {
+        return static_cast<Id>( a ^ ( ( a ^ b ) & ( std::size_t{ 0 } - less( b, a ) ) ) );
+    } };
+    std::size_t node{ size - 1 };
+    for ( ; node > 0 && 2 * node >= size; --node )
+        winners[node] = pick( 2 * node - size, 2 * node + 1 - size );
+    for ( ; node > 0; --node )
+        winners[node] = pick( winner_of( 2 * node ), winner_of( 2 * node + 1 ) );
+
+    PMERGEME_PHASE( phases, "replays" );
+    std::vector<std::size_t> order;
+    order.reserve( k );
+    while ( true )
+    {
+        std::size_t winner{ winners[size > 1 ? 1 : 0] };
+        order.push_back( winner );
+        if ( order.size() == k )
+            return order;
+
+        // Only the matches on the path of the winner change
+        taken[winner] = true;
+        for ( std::size_t node{ ( winner + size ) / 2 }; node > 0; node /= 2 )
+            play( node );
+    }
+}
+
+/*----------------Helper functions for adaptive sorting----------------*/
+
+template <typename ForwardIt, typename Less>
+bool looksPresorted( ForwardIt first, std::size_t size, Less& less )
+{
+    constexpr std::size_t probe_count{ 16 };
+
+    // Compare neighbours at evenly spread places: in a random order, about half of them are descents, and the
+    // direction changes from one probe to the next about half of the time
+    std::size_t descents{ 0 };
+    std::size_t changes{ 0 };
+    bool        previous_descent{ false };
+    std::size_t pos{ 0 };
+    for ( std::size_t probe{ 0 }; probe < probe_count; ++probe )
+    {
+        std::size_t next_pos{ probe * ( size - 1 ) / probe_count };
+        std::advance( first, next_pos - pos );
+        pos = next_pos;
+
+        bool descent{ less( *std::next( first ), *first ) };
+        descents += descent;
+        changes += probe > 0 && descent != previous_descent;
+        previous_descent = descent;
+    }
+    return descents <= probe_count / 8 || descents >= probe_count - probe_count / 8 || changes <= probe_count / 8;
+}
+
+template <typename RandomIt, typename Less>
+std::size_t countRun( RandomIt first, std::size_t size, Less& less )
+{
+    if ( size < 2 )
+        return size;
+
+    std::size_t length{ 2 };
+    if ( less( first[1], first[0] ) )
+    {
+        while ( length < size && less( first[length], first[length - 1] ) )
+            ++length;
+        std::reverse( first, first + length );
+    }
+    else
+    {
+        while ( length < size && !less( first[length], first[length - 1] ) )
+            ++length;
+    }
+    return length;
+}
+
+template <typename MergeAt>
+void collapseRuns( std::vector<std::size_t>& run_sizes, bool force, const MergeAt& merge_at )
+{
+    while ( run_sizes.size() > 1 )
+    {
+        // Merge the run below the top with the smaller of its neighbours
+        std::size_t k{ run_sizes.size() - 2 };
+        if ( force )
+        {
+            if ( k > 0 && run_sizes[k - 1] < run_sizes[k + 1] )
+                --k;
+        }
+        else if ( ( k > 0 && run_sizes[k - 1] <= run_sizes[k] + run_sizes[k + 1] ) ||
+                  ( k > 1 && run_sizes[k - 2] <= run_sizes[k - 1] + run_sizes[k] ) )
+        {
+            if ( run_sizes[k - 1] < run_sizes[k + 1] )
+                --k;
+        }
+        else if ( run_sizes[k] > run_sizes[k + 1] )
+            break;
+
+        merge_at( k );
+        run_sizes[k] += run_sizes[k + 1];
+        run_sizes.erase( run_sizes.begin() + static_cast<std::ptrdiff_t>( k + 1 ) );
+    }
+}
+
+template <typename RandomIt, typename Predicate>
+std::size_t gallopForward( RandomIt first, std::size_t size, const Predicate& pred )
+{
+    // Probe 0, 1, 3, 7... until pred fails, then search between the last two probes
+    std::size_t low{ 0 };
+    std::size_t offset{ 0 };
+    while ( offset < size && pred( first[offset] ) )
+    {
+        low    = offset + 1;
+        offset = 2 * offset + 1;
+    }
+    return static_cast<std::size_t>( std::partition_point( first + low, first + std::min( offset, size ), pred ) -
+                                     first );
+}
+
+template <typename RandomIt, typename Predicate>
+std::size_t gallopBackward( RandomIt first, std::size_t size, const Predicate& pred )
+{
+    // Same as gallopForward(), probing from the end
+    std::size_t high{ size };
+    std::size_t offset{ 0 };
+    while ( offset < size && pred( first[size - 1 - offset] ) )
+    {
+        high   = size - 1 - offset;
+        offset = 2 * offset + 1;
+    }
+    std::size_t low{ offset < size ? size - offset : 0 };
+    return static_cast<std::size_t>(
+        std::partition_point( first + low, first + high, [&]( const auto& x ) { return !pred( x ); } ) - first );
+}
+
+template <typename RandomIt, typename Less>
+void mergeAdjacentRuns( RandomIt first, std::size_t left_size, std::size_t right_size, Less& less,
+                        std::vector<typename std::iterator_traits<RandomIt>::value_type>& buffer )
+{
+    // After this many wins in a row from one side, gallop to find how many more it wins
+    constexpr std::size_t min_gallop{ 7 };
+
+    // Left elements not greater than the first right element, and right elements not less than the last left
+    // element, are already where they belong
+    RandomIt    left{ first };
+    RandomIt    right{ first + left_size };
+    std::size_t in_place{ gallopForward( left, left_size, [&]( const auto& x ) { return !less( *right, x ); } ) };
+    left += in_place;
+    left_size -= in_place;
+    if ( left_size == 0 )
+        return;
+    right_size = gallopForward( right, right_size, [&]( const auto& x ) { return less( x, right[-1] ); } );
+
+    // Only the shorter side goes to the buffer
+    std::size_t left_wins{ 0 };
+    std::size_t right_wins{ 0 };
+    if ( left_size <= right_size )
+    {
+        // Merge from the front; on ties the left element comes first
+        buffer.assign( std::make_move_iterator( left ), std::make_move_iterator( right ) );
+        RandomIt    out{ left };
+        std::size_t i{ 0 };
+        std::size_t j{ 0 };
+        while ( i < left_size && j < right_size )
+        {
+            if ( less( right[j], buffer[i] ) )
+            {
+                *out++ = std::move( right[j++] );
+                ++right_wins;
+                left_wins = 0;
+            }
+            else
+            {
+                *out++ = std::move( buffer[i++] );
+                ++left_wins;
+                right_wins = 0;
+            }
+
+            if ( left_wins >= min_gallop && i < left_size )
+            {
+                std::size_t count{ gallopForward( buffer.begin() + i, left_size - i,
+                                                  [&]( const auto& x ) { return !less( right[j], x ); } ) };
+                out = std::move( buffer.begin() + i, buffer.begin() + i + count, out );
+                i += count;
+                left_wins = 0;
+            }
+            else if ( right_wins >= min_gallop && j < right_size )
+            {
+                std::size_t count{ gallopForward( right + j, right_size - j,
+                                                  [&]( const auto& x ) { return less( x, buffer[i] ); } ) };
+                out = std::move( right + j, right + j + count, out );
+                j += count;
+                right_wins = 0;
+            }
+        }
+        std::move( buffer.begin() + i, buffer.begin() + left_size, out );
+    }
+    else
+    {
+        // Merge from the back; on ties the right element comes last
+        buffer.assign( std::make_move_iterator( right ), std::make_move_iterator( right + right_size ) );
+        RandomIt    out{ right + right_size };
+        std::size_t i{ right_size };
+        std::size_t j{ left_size };
+        while ( i > 0 && j > 0 )
+        {
+            if ( less( buffer[i - 1], left[j - 1] ) )
+            {
+                *--out = std::move( left[--j] );
+                ++left_wins;
+                right_wins = 0;
+            }
+            else
+            {
+                *--out = std::move( buffer[--i] );
+                ++right_wins;
+                left_wins = 0;
+            }
+
+            if ( left_wins >= min_gallop && j > 0 )
+            {
+                std::size_t start{ gallopBackward( left, j,
+                                                   [&]( const auto& x ) { return less( buffer[i - 1], x ); } ) };
+                out = std::move_backward( left + start, left + j, out );
+                j   = start;
+                left_wins = 0;
+            }
+            else if ( right_wins >= min_gallop && i > 0 )
+            {
+                std::size_t start{ gallopBackward( buffer.begin(), i,
+                                                   [&]( const auto& x ) { return !less( x, left[j - 1] ); } ) };
+                out = std::move_backward( buffer.begin() + start, buffer.begin() + i, out );
+                i   = start;
+                right_wins = 0;
+            }
+        }
+        std::move_backward( buffer.begin(), buffer.begin() + i, out );
+    }
+}
+
+template <typename RandomIt, typename Less>
+void mergeRuns( RandomIt first, std::size_t size, Less& less )
+{
+    using Value = typename std::iterator_traits<RandomIt>::value_type;
+
+    PMERGEME_PHASES( phases );
+    PMERGEME_PHASE( phases, "runs" );
+
+    // Stack of runs still to be merged, kept balanced the way TimSort does
+    std::vector<std::size_t> run_starts;
+    std::vector<std::size_t> run_sizes;
+    std::vector<Value>       buffer;
+    auto                     merge_at{ [&]( std::size_t k ) {
+        mergeAdjacentRuns( first + run_starts[k], run_sizes[k], run_sizes[k + 1], less, buffer );
+        run_starts.erase( run_starts.begin() + static_cast<std::ptrdiff_t>( k + 1 ) );
+    } };
+    auto push_run{ [&]( std::size_t start, std::size_t length ) {
+        run_starts.push_back( start );
+        run_sizes.push_back( length );
+        collapseRuns( run_sizes, false, merge_at );
+    } };
+
+    // Consecutive short runs make a disordered stretch, which merge-insertion turns into one run
+    std::size_t disordered_start{ 0 };
+    std::size_t pos{ 0 };
+    while ( pos < size )
+    {
+        std::size_t length{ countRun( first + pos, size - pos, less ) };
+        if ( length >= PmergeMe::ADAPTIVE_MIN_RUN )
+        {
+            if ( disordered_start < pos )
+            {
+                mergeInsertionSort( first + disordered_start, pos - disordered_start, less );
+                push_run( disordered_start, pos - disordered_start );
+            }
+            push_run( pos, length );
+            disordered_start = pos + length;
+        }
+        pos += length;
+    }
+    if ( disordered_start < size )
+    {
+        mergeInsertionSort( first + disordered_start, size - disordered_start, less );
+        push_run( disordered_start, size - disordered_start );
+    }
+    collapseRuns( run_sizes, true, merge_at );
+}
+
+template <typename T, typename Alloc, typename Compare>
+void mergeRuns( std::list<T, Alloc>& lst, Compare& comp )
+{
+    using List = std::list<T, Alloc>;
+
+    PMERGEME_PHASES( phases );
+    PMERGEME_PHASE( phases, "runs" );
+
+    std::vector<List>        runs;
+    std::vector<std::size_t> run_sizes;
+    auto                     merge_at{ [&]( std::size_t k ) {
+        runs[k].merge( runs[k + 1], comp );
+        runs.erase( runs.begin() + static_cast<std::ptrdiff_t>( k + 1 ) );
+    } };
+    auto push_run{ [&]( List& run, std::size_t length ) {
+        runs.push_back( std::move( run ) );
+        run_sizes.push_back( length );
+        collapseRuns( run_sizes, false, merge_at );
+    } };
+
+    // Runs are spliced off the front of lst; consecutive short runs make a disordered stretch, which
+    // merge-insertion turns into one run
+    List        disordered( lst.get_allocator() );
+    std::size_t disordered_size{ 0 };
+    while ( !lst.empty() )
+    {
+        auto        previous{ lst.begin() };
+        auto        next{ std::next( previous ) };
+        bool        descending{ next != lst.end() && comp( *next, *previous ) };
+        std::size_t length{ 1 };
+        while ( next != lst.end() && ( descending ? comp( *next, *previous ) : !comp( *next, *previous ) ) )
+        {
+            previous = next++;
+            ++length;
+        }
+
+        List run( lst.get_allocator() );
+        run.splice( run.end(), lst, lst.begin(), next );
+        if ( descending )
+            run.reverse();
+
+        if ( length < PmergeMe::ADAPTIVE_MIN_RUN )
+        {
+            disordered.splice( disordered.end(), run );
+            disordered_size += length;
+            continue;
+        }
+        if ( disordered_size > 0 )
+        {
+            mergeInsertionList( disordered, comp );
+            push_run( disordered, disordered_size );
+            disordered      = List( lst.get_allocator() );
+            disordered_size = 0;
+        }
+        push_run( run, length );
+    }
+    if ( disordered_size > 0 )
+    {
+        mergeInsertionList( disordered, comp );
+        push_run( disordered, disordered_size );
+    }
+    collapseRuns( run_sizes, true, merge_at );
+
+    lst.splice( lst.end(), runs[0] );
+}
+
+/*----------------Helper functions for list sorting----------------*/
+
+// Merge-insertion sort of lst that only relinks its nodes (splice), so elements are never copied or moved
+template <typename T, typename Alloc, typename Compare>
+void mergeInsertionList( std::list<T, Alloc>& lst, Compare& comp )
+{
+    using Iterator = typename std::list<T, Alloc>::iterator;
+
+    PMERGEME_PHASES( phases );
+    PMERGEME_PHASE( phases, "pairing" );
+
+    // Nothing to be done if already sorted
+    if ( std::is_sorted( lst.begin(), lst.end(), comp ) )
+        return;
+
+    // Create pairs in place, then leave out the odd one for now
+    std::size_t pair_count{ lst.size() / 2 };
+    createSortedPairs( lst, comp );
+    std::list<T, Alloc> remaining_list( lst.get_allocator() );
+    bool                has_straggler{ lst.size() % 2 != 0 };
+    if ( has_straggler )
+        remaining_list.splice( remaining_list.end(), lst, std::prev( lst.end() ) );
+
+    // Merge sort the pairs
+    PMERGEME_PHASE( phases, "pair sort" );
+    mergeSortPairs( lst, pair_count, comp );
+
+    // Give every node an id, with a handle to it (list iterators stay valid across splices): the main chain
+    // starts as ids 0..pair_count, the remaining elements get the next ids
+    PMERGEME_PHASE( phases, "insertion" );
+    std::vector<Iterator>    handles( 2 * pair_count + has_straggler );
+    std::vector<std::size_t> pending;
+    std::vector<std::size_t> partner; // partner[k] is the id of the greater of pending[k]
+    pending.reserve( pair_count );
+    partner.reserve( pair_count );
+
+    auto it{ lst.begin() };
+    for ( std::size_t p{ 0 }; p < pair_count; ++p )
+    {
+        handles[p + 1] = it++;
+        Iterator smaller{ it++ };
+
+        // First element in main chain is the smaller of the first pair
+        if ( p == 0 )
+        {
+            handles[0] = smaller;
+            lst.splice( lst.begin(), lst, smaller );
+        }
+        else
+        {
+            handles[pair_count + p] = smaller;
+            pending.push_back( pair_count + p );
+            partner.push_back( p + 1 );
+            remaining_list.splice( remaining_list.end(), lst, smaller );
+        }
+    }
+    // Don't forget the left out odd (it can go anywhere in the chain)
+    if ( has_straggler )
+    {
+        handles.back() = remaining_list.begin();
+        pending.push_back( handles.size() - 1 );
+    }
+
+    // The list cannot find the element at a rank without walking to it, so ranks are looked up in a
+    // MainChain of the ids, which is kept in the same order as lst
+    std::vector<std::size_t> initial_chain( pair_count + 1 );
+    for ( std::size_t id{ 0 }; id <= pair_count; ++id )
+        initial_chain[id] = id;
+    MainChain chain{ initial_chain, handles.size() };
+
+    // FJ algorithm uses Jacobsthal numbers to determine the order of insertion (of the smaller of every pair
+    // but the first, and the straggler)
+    for ( auto idx : JacobsthalOrder{ pending.size() } )
+    {
+        // Only the part of the chain before its partner can hold the element
+        std::size_t bound{ idx < partner.size() ? chain.rankOf( partner[idx] ) : chain.size() };
+
+        const T&    value{ *handles[pending[idx]] };
+        std::size_t insertion_rank{ chain.lowerBound(
+            bound, [&]( std::size_t id ) { return comp( *handles[id], value ); } ) };
+
+        // Relink the node in front of the element currently at that rank
+        Iterator insertion_pos{ insertion_rank < chain.size() ? handles[chain.at( insertion_rank )] : lst.end() };
+        lst.splice( insertion_pos, remaining_list, handles[pending[idx]] );
+        chain.insert( insertion_rank, pending[idx] );
+    }
+}
+
+// In one pass, order each pair of adjacent elements of lst so that the greater comes first
+// A last odd element is left where it is
+template <typename T, typename Alloc, typename Compare>
+void createSortedPairs( std::list<T, Alloc>& lst, Compare& comp )
+{
+    for ( auto first{ lst.begin() }; first != lst.end() && std::next( first ) != lst.end(); )
+    {
+        auto second{ std::next( first ) };
+        auto next_pair{ std::next( second ) };
+
+        if ( comp( *first, *second ) )
+            lst.splice( first, lst, second );
+
+        first = next_pair;
+    }
+}
+
+// Use merge sort to sort the pair_count pairs of pairs_list (two adjacent nodes each) by their first element
+template <typename T, typename Alloc, typename Compare>
+void mergeSortPairs( std::list<T, Alloc>& pairs_list, std::size_t pair_count, Compare& comp )
+{
+    if ( pair_count < 2 )
+        return;
+
+    // Split off the first half; splice relinks the nodes instead of copying them
+    std::size_t         half_count{ pair_count / 2 };
+    std::list<T, Alloc> list_half_1( pairs_list.get_allocator() );
+    list_half_1.splice( list_half_1.begin(), pairs_list, pairs_list.begin(),
+                        std::next( pairs_list.begin(), static_cast<std::ptrdiff_t>( 2 * half_count ) ) );
+
+    mergeSortPairs( list_half_1, half_count, comp );
+    mergeSortPairs( pairs_list, pair_count - half_count, comp );
+
+    // Merge a pair (both nodes) at a time; on equal elements the first half goes first
+    std::list<T, Alloc> merged( pairs_list.get_allocator() );
+    while ( !list_half_1.empty() && !pairs_list.empty() )
+    {
+        auto& source{ comp( pairs_list.front(), list_half_1.front() ) ? pairs_list : list_half_1 };
+        merged.splice( merged.end(), source, source.begin(), std::next( source.begin(), 2 ) );
+    }
+    merged.splice( merged.end(), list_half_1 );
+    merged.splice( merged.end(), pairs_list );
+
+    pairs_list.swap( merged );
+}
+
+/*----------------Helper functions for parallel sorting----------------*/
+
+// Run fn( begin, end ) on pool for consecutive chunks of [0, count) of grain items, and wait for all of them
+template <typename Function>
+void parallelFor( WorkStealingPool& pool, std::size_t count, std::size_t grain, const Function& fn )
+{
+    for ( std::size_t begin{ 0 }; begin < count; begin += grain )
+    {
+        std::size_t end{ std::min( begin + grain, count ) };
+        pool.submit( [&fn, begin, end]() { fn( begin, end ); } );
+    }
+    pool.wait();
+}
+
+// Stable merge sort of items on pool: chunks are sorted on their own, then merged a round at a time with
+// every merge split into equal parts (merge path). less( a, b, count ) tells whether a goes before b and
+// adds the element comparisons it made to count; their total is added to comparisons
+template <typename Item, typename Less>
+void parallelMergeSort( std::vector<Item>& items, const Less& less, WorkStealingPool& pool,
+                        std::atomic<std::size_t>& comparisons )
+{
+    constexpr std::size_t grain{ PmergeMe::PARALLEL_GRAIN };
+    std::size_t           size{ items.size() };
+
+    // Every task counts its own comparisons, so that the threads do not fight over one counter
+    auto counting{ [&less]( std::size_t& count ) {
+        return [&less, &count]( const Item& a, const Item& b ) { return less( a, b, count ); };
+    } };
+
+    std::vector<Item> buffer( size );
+    parallelFor( pool, size, grain, [&]( std::size_t begin, std::size_t end ) {
+        std::size_t count{ 0 };
+        if constexpr ( std::is_same_v<Less, PackedKeyLess> )
+            sortKeys( items.data() + begin, end - begin, buffer.data() + begin );
+        else
+            std::stable_sort( items.begin() + begin, items.begin() + end, counting( count ) );
+        comparisons += count;
+    } );
+
+    for ( std::size_t width{ grain }; width < size; width *= 2 )
+    {
+        // Merge [lo, mid) and [mid, hi) into buffer; output part k of every merge is a separate task
+        for ( std::size_t lo{ 0 }; lo < size; lo += 2 * width )
+        {
+            std::size_t mid{ std::min( lo + width, size ) };
+            std::size_t hi{ std::min( lo + 2 * width, size ) };
+
+            const Item* a{ items.data() + lo };
+            const Item* b{ items.data() + mid };
+            std::size_t a_size{ mid - lo };
+            std::size_t b_size{ hi - mid };
+
+            // Merge path: the number of items of a among the first k items of the merge, with ties taken
+            // from a first like std::merge
+            auto co_rank{ [=]( std::size_t k, std::size_t& count ) {
+                std::size_t low{ k > b_size ? k - b_size : 0 };
+                std::size_t high{ std::min( k, a_size ) };
+                while ( low < high )
+                {
+                    std::size_t i{ low + ( high - low ) / 2 };
+                    if ( !less( b[k - i - 1], a[i], count ) )
+                        low = i + 1;
+                    else
+                        high = i;
+                }
+                return low;
+            } };
+
+            for ( std::size_t k{ 0 }; k < hi - lo; k += grain )
+            {
+                pool.submit( [&, a, b, a_size, lo, hi, k, co_rank]() {
+                    std::size_t count{ 0 };
+                    std::size_t k_end{ std::min( k + grain, hi - lo ) };
+                    std::size_t i{ co_rank( k, count ) };
+                    std::size_t i_end{ co_rank( k_end, count ) };
+                    if constexpr ( std::is_same_v<Less, PackedKeyLess> )
+                        mergeKeys( a + i, i_end - i, b + ( k - i ), ( k_end - i_end ) - ( k - i ),
+                                   buffer.data() + lo + k );
+                    else
+                        std::merge( a + i, a + i_end, b + ( k - i ), b + ( k_end - i_end ), buffer.begin() + lo + k,
+                                    counting( count ) );
+                    comparisons += count;
+                } );
+            }
+        }
+        pool.wait();
+        items.swap( buffer );
+    }
+}
+
+// Merge-insertion order of elements 0..size-1 compared with less( a, b ), with every phase spread over pool
+// Pairs are sorted by a parallel merge sort instead of recursively, and the pending elements of a Jacobsthal
+// group are all searched for at once in the chain as it was before the group, then merged into it. This
+// costs more comparisons than the serial algorithm, but every phase runs in parallel
+template <typename Less>
+std::vector<std::size_t> parallelMergeInsertionOrder( std::size_t size, const Less& less, WorkStealingPool& pool,
+                                                      std::atomic<std::size_t>& comparisons, const int* int_values )
+{
+    constexpr std::size_t grain{ PmergeMe::PARALLEL_GRAIN };
+    using Pair = std::pair<std::size_t, std::size_t>; // Greater and smaller element of a pair
+
+    // Create pairs (leave out the odd one for now), then sort them by their greater element
+    PMERGEME_PHASES( phases );
+    PMERGEME_PHASE( phases, "pairing" );
+    std::size_t       pair_count{ size / 2 };
+    std::vector<Pair> pairs( pair_count );
+
+    if ( int_values && pair_count <= UINT32_MAX )
+    {
+        // As packed greater << 32 | pair keys: ties between greaters keep pair order, like the stable sort
+        // below, so the result is the same. Comparisons made by the kernels are not counted
+        std::vector<std::int64_t> keys( pair_count );
+        std::vector<std::uint8_t> swapped( pair_count );
+        parallelFor( pool, pair_count, grain, [&]( std::size_t begin, std::size_t end ) {
+            pairKeys( int_values + 2 * begin, end - begin, begin, keys.data() + begin, swapped.data() + begin );
+        } );
+        comparisons += pair_count;
+
+        PMERGEME_PHASE( phases, "pair sort" );
+        parallelMergeSort( keys, PackedKeyLess{}, pool, comparisons );
+
+        parallelFor( pool, pair_count, grain, [&]( std::size_t begin, std::size_t end ) {
+            for ( std::size_t i{ begin }; i < end; ++i )
+            {
+                auto p{ static_cast<std::size_t>( keys[i] & 0xFFFFFFFF ) };
+                pairs[i] = swapped[p] ? Pair{ 2 * p, 2 * p + 1 } : Pair{ 2 * p + 1, 2 * p };
+            }
+        } );
+    }
+    else
+    {
+        parallelFor( pool, pair_count, grain, [&]( std::size_t begin, std::size_t end ) {
+            for ( std::size_t p{ begin }; p < end; ++p )
+            {
+                bool swapped{ less( 2 * p + 1, 2 * p ) };
+                pairs[p] = swapped ? Pair{ 2 * p, 2 * p + 1 } : Pair{ 2 * p + 1, 2 * p };
+            }
+            comparisons += end - begin;
+        } );
+
+        PMERGEME_PHASE( phases, "pair sort" );
+        parallelMergeSort(
+            pairs,
+            [&]( const Pair& a, const Pair& b, std::size_t& count ) {
+                ++count;
+                return less( a.first, b.first );
+            },
+            pool, comparisons );
+    }
+
+    // Remaining elements (the smaller of pair k + 1 is pending[k]), then the left out odd, in Jacobsthal order
+    std::size_t pending_count{ pair_count - 1 + size % 2 };
+    auto        pending{ [&]( std::size_t idx ) { return idx + 1 < pair_count ? pairs[idx + 1].second : size - 1; } };
+
+    // Main chain: the smaller of the first pair, then all greaters of the pairs; chain_index[e] is the
+    // position of element e in the chain
+    PMERGEME_PHASE( phases, "insertion" );
+    std::vector<std::size_t> chain( pair_count + 1 );
+    std::vector<std::size_t> chain_index( size );
+    chain[0]                     = pairs[0].second;
+    chain_index[pairs[0].second] = 0;
+    parallelFor( pool, pair_count, grain, [&]( std::size_t begin, std::size_t end ) {
+        for ( std::size_t p{ begin }; p < end; ++p )
+        {
+            chain[p + 1]                = pairs[p].first;
+            chain_index[pairs[p].first] = p + 1;
+        }
+    } );
+
+    // Jacobsthal groups: group g holds the indexes up to JACOBSTHAL[g + 3] - 2 not in the previous groups,
+    // walked down from the highest one
+    for ( std::size_t group{ 0 }, group_low{ 0 }; group_low < pending_count; ++group )
+    {
+        std::size_t group_high{ std::min( JACOBSTHAL[group + 3] - 2, pending_count - 1 ) };
+        std::size_t group_size{ group_high - group_low + 1 };
+
+        // Find each element's rank in the chain as it is now, only looking before its partner
+        // A search costs a lot more than copying an item, hence the smaller tasks
+        std::vector<Pair> ranked( group_size ); // Rank in the chain, element
+        parallelFor( pool, group_size, grain / 16, [&]( std::size_t begin, std::size_t end ) {
+            std::size_t count{ 0 };
+            for ( std::size_t t{ begin }; t < end; ++t )
+            {
+                std::size_t idx{ group_high - t };
+                std::size_t element{ pending( idx ) };
+                std::size_t bound{ idx + 1 < pair_count ? chain_index[pairs[idx + 1].first] : chain.size() };
+
+                auto pos{ std::lower_bound( chain.begin(), chain.begin() + bound, element,
+                                            [&]( std::size_t a, std::size_t b ) {
+                                                ++count;
+                                                return less( a, b );
+                                            } ) };
+                ranked[t] = Pair{ static_cast<std::size_t>( pos - chain.begin() ), element };
+            }
+            comparisons += count;
+        } );
+
+        // Elements that go in front of the same chain element still have to be ordered among themselves
+        parallelMergeSort(
+            ranked,
+            [&]( const Pair& a, const Pair& b, std::size_t& count ) {
+                if ( a.first != b.first )
+                    return a.first < b.first;
+                ++count;
+                return less( a.second, b.second );
+            },
+            pool, comparisons );
+
+        // Merge the group into the chain; every task fills the part that starts with a range of the old chain
+        std::vector<std::size_t> next_chain( chain.size() + group_size );
+        parallelFor( pool, chain.size(), grain, [&]( std::size_t begin, std::size_t end ) {
+            bool last_part{ end == chain.size() };
+            auto rank_less{ []( const Pair& a, std::size_t rank ) { return a.first < rank; } };
+            auto item{ std::lower_bound( ranked.begin(), ranked.end(), begin, rank_less ) };
+            auto item_end{ last_part ? ranked.end() : std::lower_bound( item, ranked.end(), end, rank_less ) };
+            auto out{ begin + static_cast<std::size_t>( item - ranked.begin() ) };
+
+            for ( std::size_t c{ begin }; c < end; ++c )
+            {
+                for ( ; item != item_end && item->first == c; ++item, ++out )
+                {
+                    next_chain[out]           = item->second;
+                    chain_index[item->second] = out;
+                }
+                next_chain[out]       = chain[c];
+                chain_index[chain[c]] = out++;
+            }
+            // Elements ranked after the whole chain
+            for ( ; item != item_end; ++item, ++out )
+            {
+                next_chain[out]           = item->second;
+                chain_index[item->second] = out;
+            }
+        } );
+        chain.swap( next_chain );
+
+        group_low = group_high + 1;
+    }
+
+    return chain;
+}
+
+#endif /* PMERGEME_TPP */
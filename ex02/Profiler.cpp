@@ -0,0 +1,196 @@
+#include "Profiler.hpp"
+#include <cerrno>
+#include <chrono>
+#include <cstring> // std::strerror
+#include <iomanip>
+#include <linux/perf_event.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+
+// Counters in the order of Profiler::Sample::counters
+constexpr std::array<std::uint64_t, Profiler::COUNTER_COUNT> COUNTER_CONFIGS{
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS, PERF_COUNT_HW_BRANCH_MISSES, PERF_COUNT_HW_CACHE_MISSES };
+constexpr std::array<const char*, Profiler::COUNTER_COUNT> COUNTER_NAMES{ "cycles", "instructions",
+                                                                          "branch-misses", "cache-misses" };
+
+// User-space counting only, which perf_event_paranoid allows up to level 2; group members follow the leader
+int openCounter( std::uint64_t config, int group )
+{
+    perf_event_attr attr{};
+    attr.size           = sizeof( attr );
+    attr.type           = PERF_TYPE_HARDWARE;
+    attr.config         = config;
+    attr.disabled       = group < 0;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv     = 1;
+    attr.read_format    = PERF_FORMAT_GROUP;
+
+    return static_cast<int>( syscall( SYS_perf_event_open, &attr, 0, -1, group, 0 ) );
+}
+
+// Phases
+
+Profiler::Phases::~Phases()
+{
+    stop();
+}
+
+void Profiler::Phases::start( std::string_view name )
+{
+    stop();
+    if ( recording() )
+    {
+        push( name );
+        m_running = true;
+    }
+}
+
+void Profiler::Phases::stop()
+{
+    if ( m_running )
+        pop();
+    m_running = false;
+}
+
+// Profiler
+
+void Profiler::enable()
+{
+    s_enabled = true;
+    s_thread  = std::this_thread::get_id();
+
+    if ( s_group >= 0 )
+        return;
+
+    // Counters the CPU (or a virtual machine) does not have are simply left out of the group
+    s_group = openCounter( COUNTER_CONFIGS[0], -1 );
+    if ( s_group < 0 )
+    {
+        s_counter_error = std::strerror( errno );
+        return;
+    }
+    s_has_counter[0] = true;
+    for ( std::size_t i{ 1 }; i < COUNTER_COUNT; ++i )
+        s_has_counter[i] = openCounter( COUNTER_CONFIGS[i], s_group ) >= 0;
+
+    ioctl( s_group, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP );
+    ioctl( s_group, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP );
+}
+
+bool Profiler::enabled()
+{
+    return s_enabled;
+}
+
+const std::string& Profiler::counterError()
+{
+    return s_counter_error;
+}
+
+void Profiler::report( std::ostream& out )
+{
+    out << std::left << std::setw( 20 ) << "  phase" << std::right << std::setw( 8 ) << "calls" << std::setw( 12 )
+        << "total (ms)" << std::setw( 12 ) << "self (ms)";
+    if ( s_group >= 0 )
+        for ( std::size_t i{ 0 }; i < COUNTER_COUNT; ++i )
+            if ( s_has_counter[i] )
+                out << std::setw( 15 ) << COUNTER_NAMES[i];
+    out << '\n';
+
+    for ( const auto& phase : s_phases )
+    {
+        out << std::left << std::setw( 20 ) << "  " + phase.name << std::right << std::setw( 8 ) << phase.calls
+            << std::fixed << std::setprecision( 3 ) << std::setw( 12 ) << phase.total.nanoseconds / 1e6
+            << std::setw( 12 ) << phase.self.nanoseconds / 1e6;
+        if ( s_group >= 0 )
+            for ( std::size_t i{ 0 }; i < COUNTER_COUNT; ++i )
+                if ( s_has_counter[i] )
+                    out << std::setw( 15 ) << phase.self.counters[i];
+        out << '\n';
+    }
+
+    if ( s_group < 0 )
+        out << "  (no hardware counters, perf_event_open: " << s_counter_error << ")\n";
+    else
+        out << "  (counters are for the self part of each phase)\n";
+
+    s_phases.clear();
+}
+
+// Private helpers
+
+bool Profiler::recording()
+{
+    return s_enabled && std::this_thread::get_id() == s_thread;
+}
+
+Profiler::Sample Profiler::sample()
+{
+    Sample now;
+    now.nanoseconds = static_cast<std::uint64_t>( std::chrono::duration_cast<std::chrono::nanoseconds>(
+                                                      std::chrono::steady_clock::now().time_since_epoch() )
+                                                      .count() );
+
+    // A group read gives the number of counters, then their values in the order they were opened
+    if ( s_group >= 0 )
+    {
+        std::array<std::uint64_t, COUNTER_COUNT + 1> values{};
+        if ( read( s_group, values.data(), sizeof( values ) ) > 0 )
+        {
+            std::size_t next{ 1 };
+            for ( std::size_t i{ 0 }; i < COUNTER_COUNT; ++i )
+                if ( s_has_counter[i] )
+                    now.counters[i] = values[next++];
+        }
+    }
+
+    return now;
+}
+
+void Profiler::push( std::string_view name )
+{
+    std::size_t phase{ 0 };
+    while ( phase < s_phases.size() && s_phases[phase].name != name )
+        ++phase;
+    if ( phase == s_phases.size() )
+        s_phases.push_back( Phase{ std::string{ name } } );
+
+    ++s_phases[phase].calls;
+    ++s_phases[phase].running;
+    s_stack.push_back( Frame{ phase, sample() } );
+}
+
+void Profiler::pop()
+{
+    Frame frame{ s_stack.back() };
+    s_stack.pop_back();
+
+    Sample spent{ sample() - frame.begin };
+    Phase& phase{ s_phases[frame.phase] };
+    phase.self += spent - frame.nested;
+    if ( --phase.running == 0 )
+        phase.total += spent;
+
+    if ( !s_stack.empty() )
+        s_stack.back().nested += spent;
+}
+
+// Sample
+
+Profiler::Sample Profiler::Sample::operator-( const Sample& other ) const
+{
+    Sample difference;
+    difference.nanoseconds = nanoseconds - other.nanoseconds;
+    for ( std::size_t i{ 0 }; i < COUNTER_COUNT; ++i )
+        difference.counters[i] = counters[i] - other.counters[i];
+    return difference;
+}
+
+Profiler::Sample& Profiler::Sample::operator+=( const Sample& other )
+{
+    nanoseconds += other.nanoseconds;
+    for ( std::size_t i{ 0 }; i < COUNTER_COUNT; ++i )
+        counters[i] += other.counters[i];
+    return *this;
+}
@@ -0,0 +1,98 @@
+#ifndef PROFILER_HPP
+#define PROFILER_HPP
+
+#include <array>
+#include <cstddef>
+#include <cstdint>
+#include <ostream>
+#include <string>
+#include <string_view>
+#include <thread>
+#include <vector>
+
+// Phase profiler for the sorting engines: wall time per named phase and, when Linux lets us open them,
+// hardware counters (perf_event_open). Phases nest (a recursive sort runs its own phases inside "pair sort"),
+// so every phase gets a total, which includes the phases nested in it, and a self part, which does not
+// The engines are instrumented with the PMERGEME_PHASES / PMERGEME_PHASE macros below, which expand to
+// nothing unless built with -DPMERGEME_PROFILE (make PROFILE=1)
+class Profiler
+{
+  public:
+    // Cycles, instructions, branch misses, cache misses
+    static constexpr std::size_t COUNTER_COUNT{ 4 };
+
+    // Consecutive phases of one function: start() ends the previous phase, and the destructor the last one
+    class Phases
+    {
+      public:
+        // OCF (a running phase has a single owner)
+        Phases()                                 = default;
+        Phases( const Phases& other )            = delete;
+        Phases& operator=( const Phases& other ) = delete;
+        ~Phases();
+
+        void start( std::string_view name );
+        void stop();
+
+      private:
+        bool m_running{ false };
+    };
+
+    // Record the phases run by the calling thread from now on (other threads are ignored)
+    // Opens the hardware counters; if that fails, only times are recorded and counterError() says why
+    static void enable();
+    static bool enabled();
+    static const std::string& counterError();
+
+    // Print the phases recorded since the last report, then forget them
+    static void report( std::ostream& out );
+
+  private:
+    struct Sample
+    {
+        std::uint64_t                            nanoseconds{ 0 };
+        std::array<std::uint64_t, COUNTER_COUNT> counters{};
+
+        Sample  operator-( const Sample& other ) const;
+        Sample& operator+=( const Sample& other );
+    };
+
+    struct Phase
+    {
+        std::string name{};
+        std::size_t calls{ 0 };
+        std::size_t running{ 0 }; // Recursive calls only count once in the total
+        Sample      total{};
+        Sample      self{};
+    };
+
+    struct Frame
+    {
+        std::size_t phase{ 0 };
+        Sample      begin{};
+        Sample      nested{}; // Spent in phases nested in this one
+    };
+
+    inline static bool                            s_enabled{ false };
+    inline static std::thread::id                 s_thread{};
+    inline static int                             s_group{ -1 }; // Leader of the counter group
+    inline static std::array<bool, COUNTER_COUNT> s_has_counter{};
+    inline static std::string                     s_counter_error{};
+    inline static std::vector<Phase>              s_phases{};
+    inline static std::vector<Frame>              s_stack{};
+
+    static bool   recording();
+    static Sample sample();
+    static void   push( std::string_view name );
+    static void   pop();
+};
+
+#ifdef PMERGEME_PROFILE
+#define PMERGEME_PHASES( phases ) Profiler::Phases phases
+#define PMERGEME_PHASE( phases, name ) phases.start( name )
+#else
+#define PMERGEME_PHASES( phases )
+#define PMERGEME_PHASE( phases, name )
+#endif
+
+#endif /* PROFILER_HPP */
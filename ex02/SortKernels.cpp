@@ -0,0 +1,276 @@
+#include "SortKernels.hpp"
+#include <algorithm>
+#include <cstring>
+
+#if defined( __x86_64__ ) || defined( __i386__ )
+#include <immintrin.h>
+#define SORTKERNELS_X86
+#define AVX2_TARGET __attribute__( ( target( "avx2" ) ) )
+#endif
+
+// Sorting networks work on blocks of this many keys (four registers of four keys)
+constexpr std::size_t BLOCK_KEYS{ 16 };
+
+/*----------------Scalar kernels----------------*/
+
+std::int64_t packKey( int value, std::size_t index )
+{
+    return static_cast<std::int64_t>( value ) * ( std::int64_t{ 1 } << 32 ) + static_cast<std::int64_t>( index );
+}
+
+void pairKeysScalar( const int* values, std::size_t pair_count, std::size_t first_pair, std::int64_t* keys,
+                     std::uint8_t* swapped )
+{
+    for ( std::size_t p{ 0 }; p < pair_count; ++p )
+    {
+        int first{ values[2 * p] };
+        int second{ values[2 * p + 1] };
+        swapped[p] = second < first;
+        keys[p]    = packKey( std::max( first, second ), first_pair + p );
+    }
+}
+
+void sortKeysScalar( std::int64_t* keys, std::size_t size, std::int64_t* )
+{
+    std::sort( keys, keys + size );
+}
+
+void mergeKeysScalar( const std::int64_t* a, std::size_t a_size, const std::int64_t* b, std::size_t b_size,
+                      std::int64_t* out )
+{
+    std::merge( a, a + a_size, b, b + b_size, out );
+}
+
+/*----------------AVX2 kernels----------------*/
+
+#ifdef SORTKERNELS_X86
+
+// Compare-exchange lane by lane: a gets the minimums, b the maximums (AVX2 has no 64-bit min/max)
+AVX2_TARGET inline void minMax( __m256i& a, __m256i& b )
+{
+    __m256i greater{ _mm256_cmpgt_epi64( a, b ) };
+    __m256i min{ _mm256_blendv_epi8( a, b, greater ) };
+    b = _mm256_blendv_epi8( b, a, greater );
+    a = min;
+}
+
+// Sort the four lanes of a bitonic register (distance 2, then distance 1)
+AVX2_TARGET inline __m256i bitonicClean( __m256i v )
+{
+    __m256i low{ v };
+    __m256i high{ _mm256_permute4x64_epi64( v, 0x4E ) };
+    minMax( low, high );
+    v = _mm256_blend_epi32( low, high, 0xF0 );
+
+    low  = v;
+    high = _mm256_permute4x64_epi64( v, 0xB1 );
+    minMax( low, high );
+    return _mm256_blend_epi32( low, high, 0xCC );
+}
+
+// Merge two sorted registers: low gets the four smallest keys, high the four largest, both sorted
+AVX2_TARGET inline void bitonicMerge( __m256i& low, __m256i& high )
+{
+    high = _mm256_permute4x64_epi64( high, 0x1B ); // Reversed, so that low then high is bitonic
+    minMax( low, high );
+    low  = bitonicClean( low );
+    high = bitonicClean( high );
+}
+
+// Sort 16 keys: a sorting network down the columns, a transpose, then bitonic merges of the columns
+AVX2_TARGET void sortBlockAvx2( std::int64_t* keys )
+{
+    __m256i r0{ _mm256_loadu_si256( reinterpret_cast<const __m256i*>( keys ) ) };
+    __m256i r1{ _mm256_loadu_si256( reinterpret_cast<const __m256i*>( keys + 4 ) ) };
+    __m256i r2{ _mm256_loadu_si256( reinterpret_cast<const __m256i*>( keys + 8 ) ) };
+    __m256i r3{ _mm256_loadu_si256( reinterpret_cast<const __m256i*>( keys + 12 ) ) };
+
+    // Optimal network for 4 elements, on every column at once
+    minMax( r0, r1 );
+    minMax( r2, r3 );
+    minMax( r0, r2 );
+    minMax( r1, r3 );
+    minMax( r1, r2 );
+
+    // Transpose, so that every register holds one sorted column
+    __m256i t0{ _mm256_unpacklo_epi64( r0, r1 ) };
+    __m256i t1{ _mm256_unpackhi_epi64( r0, r1 ) };
+    __m256i t2{ _mm256_unpacklo_epi64( r2, r3 ) };
+    __m256i t3{ _mm256_unpackhi_epi64( r2, r3 ) };
+    r0 = _mm256_permute2x128_si256( t0, t2, 0x20 );
+    r1 = _mm256_permute2x128_si256( t1, t3, 0x20 );
+    r2 = _mm256_permute2x128_si256( t0, t2, 0x31 );
+    r3 = _mm256_permute2x128_si256( t1, t3, 0x31 );
+
+    // 4 + 4 twice, then 8 + 8: reverse the second run, split in halves, then clean each half
+    bitonicMerge( r0, r1 );
+    bitonicMerge( r2, r3 );
+    __m256i b_low{ _mm256_permute4x64_epi64( r3, 0x1B ) };
+    __m256i b_high{ _mm256_permute4x64_epi64( r2, 0x1B ) };
+    minMax( r0, b_low );
+    minMax( r1, b_high );
+    minMax( r0, r1 );
+    minMax( b_low, b_high );
+
+    _mm256_storeu_si256( reinterpret_cast<__m256i*>( keys ), bitonicClean( r0 ) );
+    _mm256_storeu_si256( reinterpret_cast<__m256i*>( keys + 4 ), bitonicClean( r1 ) );
+    _mm256_storeu_si256( reinterpret_cast<__m256i*>( keys + 8 ), bitonicClean( b_low ) );
+    _mm256_storeu_si256( reinterpret_cast<__m256i*>( keys + 12 ), bitonicClean( b_high ) );
+}
+
+// Four pairs at a time: swap neighbours within the register, then compare and take the maximum
+AVX2_TARGET void pairKeysAvx2( const int* values, std::size_t pair_count, std::size_t first_pair,
+                               std::int64_t* keys, std::uint8_t* swapped )
+{
+    std::size_t p{ 0 };
+    __m256i     index{ _mm256_add_epi64( _mm256_set1_epi64x( static_cast<long long>( first_pair ) ),
+                                         _mm256_setr_epi64x( 0, 1, 2, 3 ) ) };
+    const __m256i four{ _mm256_set1_epi64x( 4 ) };
+
+    for ( ; p + 4 <= pair_count; p += 4 )
+    {
+        __m256i v{ _mm256_loadu_si256( reinterpret_cast<const __m256i*>( values + 2 * p ) ) };
+        __m256i neighbour{ _mm256_shuffle_epi32( v, 0xB1 ) };
+
+        // The low half of every 64-bit lane holds the first value of a pair: move the greater value up
+        __m256i greater{ _mm256_max_epi32( v, neighbour ) };
+        __m256i key{ _mm256_or_si256( _mm256_slli_epi64( greater, 32 ), index ) };
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( keys + p ), key );
+        index = _mm256_add_epi64( index, four );
+
+        int mask{ _mm256_movemask_ps( _mm256_castsi256_ps( _mm256_cmpgt_epi32( v, neighbour ) ) ) };
+        for ( std::size_t i{ 0 }; i < 4; ++i )
+            swapped[p + i] = ( mask >> ( 2 * i ) ) & 1;
+    }
+
+    pairKeysScalar( values + 2 * p, pair_count - p, first_pair + p, keys + p, swapped + p );
+}
+
+// Streaming merge: keep the four largest keys seen in a register and merge in four keys at a time from
+// whichever input has the smaller next key
+AVX2_TARGET void mergeKeysAvx2( const std::int64_t* a, std::size_t a_size, const std::int64_t* b,
+                                std::size_t b_size, std::int64_t* out )
+{
+    if ( a_size < 4 || b_size < 4 )
+    {
+        mergeKeysScalar( a, a_size, b, b_size, out );
+        return;
+    }
+
+    __m256i low{ _mm256_loadu_si256( reinterpret_cast<const __m256i*>( a ) ) };
+    __m256i high{ _mm256_loadu_si256( reinterpret_cast<const __m256i*>( b ) ) };
+    std::size_t i{ 4 };
+    std::size_t j{ 4 };
+
+    while ( true )
+    {
+        bitonicMerge( low, high );
+        _mm256_storeu_si256( reinterpret_cast<__m256i*>( out ), low );
+        out += 4;
+
+        // The next four keys must come from the input with the smaller next key
+        if ( i + 4 <= a_size && ( j == b_size || a[i] <= b[j] ) )
+        {
+            low = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( a + i ) );
+            i += 4;
+        }
+        else if ( j + 4 <= b_size && ( i == a_size || b[j] < a[i] ) )
+        {
+            low = _mm256_loadu_si256( reinterpret_cast<const __m256i*>( b + j ) );
+            j += 4;
+        }
+        else
+            break;
+    }
+
+    // Fewer than four keys are left in one of the inputs: finish with a scalar three-way merge
+    std::int64_t carried[4];
+    _mm256_storeu_si256( reinterpret_cast<__m256i*>( carried ), high );
+    std::size_t k{ 0 };
+    while ( k < 4 || i < a_size || j < b_size )
+    {
+        const std::int64_t* next{ nullptr };
+        if ( k < 4 )
+            next = carried + k;
+        if ( i < a_size && ( !next || a[i] < *next ) )
+            next = a + i;
+        if ( j < b_size && ( !next || b[j] < *next ) )
+            next = b + j;
+
+        *out++ = *next;
+        if ( next == carried + k )
+            ++k;
+        else if ( next == a + i )
+            ++i;
+        else
+            ++j;
+    }
+}
+
+// Sorted blocks of 16 keys, then rounds of merges back and forth between keys and buffer
+AVX2_TARGET void sortKeysAvx2( std::int64_t* keys, std::size_t size, std::int64_t* buffer )
+{
+    std::size_t block_end{ size - size % BLOCK_KEYS };
+    for ( std::size_t begin{ 0 }; begin < block_end; begin += BLOCK_KEYS )
+        sortBlockAvx2( keys + begin );
+    std::sort( keys + block_end, keys + size );
+
+    std::int64_t* src{ keys };
+    std::int64_t* dst{ buffer };
+    for ( std::size_t width{ BLOCK_KEYS }; width < size; width *= 2 )
+    {
+        for ( std::size_t lo{ 0 }; lo < size; lo += 2 * width )
+        {
+            std::size_t mid{ std::min( lo + width, size ) };
+            std::size_t hi{ std::min( lo + 2 * width, size ) };
+            mergeKeysAvx2( src + lo, mid - lo, src + mid, hi - mid, dst + lo );
+        }
+        std::swap( src, dst );
+    }
+
+    if ( src != keys )
+        std::memcpy( keys, src, size * sizeof( std::int64_t ) );
+}
+
+#endif
+
+/*----------------Dispatch----------------*/
+
+bool hasAvx2()
+{
+#ifdef SORTKERNELS_X86
+    static const bool avx2{ __builtin_cpu_supports( "avx2" ) != 0 };
+    return avx2;
+#else
+    return false;
+#endif
+}
+
+void pairKeys( const int* values, std::size_t pair_count, std::size_t first_pair, std::int64_t* keys,
+               std::uint8_t* swapped )
+{
+#ifdef SORTKERNELS_X86
+    if ( hasAvx2() )
+        return pairKeysAvx2( values, pair_count, first_pair, keys, swapped );
+#endif
+    pairKeysScalar( values, pair_count, first_pair, keys, swapped );
+}
+
+void sortKeys( std::int64_t* keys, std::size_t size, std::int64_t* buffer )
+{
+#ifdef SORTKERNELS_X86
+    if ( hasAvx2() )
+        return sortKeysAvx2( keys, size, buffer );
+#endif
+    sortKeysScalar( keys, size, buffer );
+}
+
+void mergeKeys( const std::int64_t* a, std::size_t a_size, const std::int64_t* b, std::size_t b_size,
+                std::int64_t* out )
+{
+#ifdef SORTKERNELS_X86
+    if ( hasAvx2() )
+        return mergeKeysAvx2( a, a_size, b, b_size, out );
+#endif
+    mergeKeysScalar( a, a_size, b, b_size, out );
+}
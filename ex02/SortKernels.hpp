@@ -0,0 +1,26 @@
+#ifndef SORTKERNELS_HPP
+#define SORTKERNELS_HPP
+
+#include <cstddef>
+#include <cstdint>
+
+// Kernels for sorting packed 64-bit keys, vectorised with AVX2 when the CPU has it (checked once, at run
+// time) and scalar otherwise. A key packs an int value in its upper half and an index in its lower half,
+// so comparing keys compares values first and keeps equal values in index order
+
+// Whether the AVX2 kernels are used
+bool hasAvx2();
+
+// Pair values[2p] with values[2p + 1] for p in [0, pair_count): keys[p] = greater << 32 | ( first_pair + p )
+// and swapped[p] = 1 if the second value is less than the first, 0 otherwise
+void pairKeys( const int* values, std::size_t pair_count, std::size_t first_pair, std::int64_t* keys,
+               std::uint8_t* swapped );
+
+// Sort keys in ascending order; buffer must have room for size keys
+void sortKeys( std::int64_t* keys, std::size_t size, std::int64_t* buffer );
+
+// Merge the sorted ranges a and b into out
+void mergeKeys( const std::int64_t* a, std::size_t a_size, const std::int64_t* b, std::size_t b_size,
+                std::int64_t* out );
+
+#endif /* SORTKERNELS_HPP */
@@ -0,0 +1,132 @@
+#include "WorkStealingPool.hpp"
+#include <algorithm>
+
+WorkStealingPool::WorkStealingPool( unsigned threads )
+{
+    // hardware_concurrency() may return 0 if it cannot tell
+    threads = std::max( 1u, threads );
+
+    for ( unsigned i{ 0 }; i < threads; ++i )
+        m_queues.push_back( std::make_unique<Queue>() );
+
+    for ( unsigned i{ 0 }; i < threads; ++i )
+        m_threads.emplace_back( &WorkStealingPool::workerLoop, this, i );
+}
+
+WorkStealingPool::~WorkStealingPool()
+{
+    m_stop = true;
+    notifyAll();
+
+    for ( auto& thread : m_threads )
+        thread.join();
+}
+
+void WorkStealingPool::submit( Task task )
+{
+    // Count first, so that the counters cannot drop below zero when the task is taken right away
+    ++m_pending;
+    ++m_queued;
+
+    // Spread tasks over the workers' deques; stealing evens out the rest
+    auto& queue{ *m_queues[m_next_queue++ % m_queues.size()] };
+    {
+        std::lock_guard<std::mutex> lock{ queue.mutex };
+        queue.tasks.push_back( std::move( task ) );
+    }
+
+    notifyAll();
+}
+
+void WorkStealingPool::wait()
+{
+    while ( m_pending > 0 )
+    {
+        if ( tryRunTask( 0 ) )
+            continue;
+
+        std::unique_lock<std::mutex> lock{ m_mutex };
+        m_cv.wait( lock, [this]() { return m_pending == 0 || m_queued > 0; } );
+    }
+
+    std::lock_guard<std::mutex> lock{ m_mutex };
+    if ( m_error )
+    {
+        auto error{ m_error };
+        m_error = nullptr;
+        std::rethrow_exception( error );
+    }
+}
+
+unsigned WorkStealingPool::size() const
+{
+    return static_cast<unsigned>( m_threads.size() );
+}
+
+// Run one task: from the back of our own deque first, otherwise stolen from the front of another one
+bool WorkStealingPool::tryRunTask( std::size_t home )
+{
+    Task task;
+
+    for ( std::size_t i{ 0 }; i < m_queues.size() && !task; ++i )
+    {
+        auto&                       queue{ *m_queues[( home + i ) % m_queues.size()] };
+        std::lock_guard<std::mutex> lock{ queue.mutex };
+
+        if ( queue.tasks.empty() )
+            continue;
+
+        if ( i == 0 )
+        {
+            task = std::move( queue.tasks.back() );
+            queue.tasks.pop_back();
+        }
+        else
+        {
+            task = std::move( queue.tasks.front() );
+            queue.tasks.pop_front();
+        }
+    }
+
+    if ( !task )
+        return false;
+
+    --m_queued;
+
+    try
+    {
+        task();
+    }
+    catch ( ... )
+    {
+        std::lock_guard<std::mutex> lock{ m_mutex };
+        if ( !m_error )
+            m_error = std::current_exception();
+    }
+
+    if ( --m_pending == 0 )
+        notifyAll();
+
+    return true;
+}
+
+void WorkStealingPool::workerLoop( std::size_t index )
+{
+    while ( !m_stop )
+    {
+        if ( tryRunTask( index ) )
+            continue;
+
+        std::unique_lock<std::mutex> lock{ m_mutex };
+        m_cv.wait( lock, [this]() { return m_stop || m_queued > 0; } );
+    }
+}
+
+// Taking the lock first guarantees that a thread about to sleep either sees the change or gets woken
+void WorkStealingPool::notifyAll()
+{
+    {
+        std::lock_guard<std::mutex> lock{ m_mutex };
+    }
+    m_cv.notify_all();
+}
@@ -0,0 +1,57 @@
+#ifndef WORKSTEALINGPOOL_HPP
+#define WORKSTEALINGPOOL_HPP
+
+#include <atomic>
+#include <condition_variable>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Thread pool where every worker owns a deque of tasks: owners take from the back and idle workers
+// steal from the front of other deques, so uneven tasks still keep every thread busy
+class WorkStealingPool
+{
+  public:
+    using Task = std::function<void()>;
+
+    // OCF (threads cannot be copied)
+    explicit WorkStealingPool( unsigned threads = std::thread::hardware_concurrency() );
+    WorkStealingPool( const WorkStealingPool& other )            = delete;
+    WorkStealingPool& operator=( const WorkStealingPool& other ) = delete;
+    ~WorkStealingPool();
+
+    void submit( Task task );
+    // Block until every submitted task has finished, running tasks on the calling thread meanwhile
+    // Rethrow the first exception thrown by a task, if any
+    void wait();
+
+    unsigned size() const;
+
+  private:
+    struct Queue
+    {
+        std::mutex       mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread>            m_threads;
+    std::atomic<std::size_t>            m_queued{ 0 };  // Submitted but not yet taken
+    std::atomic<std::size_t>            m_pending{ 0 }; // Submitted but not yet finished
+    std::atomic<std::size_t>            m_next_queue{ 0 };
+    std::atomic<bool>                   m_stop{ false };
+    std::mutex                          m_mutex; // Guards sleeping and m_error
+    std::condition_variable             m_cv;
+    std::exception_ptr                  m_error;
+
+    bool tryRunTask( std::size_t home );
+    void workerLoop( std::size_t index );
+    void notifyAll();
+};
+
+#endif /* WORKSTEALINGPOOL_HPP */
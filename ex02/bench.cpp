@@ -0,0 +1,460 @@
+#include "PmergeMe.hpp"
+#include "WorkStealingPool.hpp"
+#include <algorithm>
+#include <chrono>
+#include <cstdint>
+#include <iomanip>
+#include <iostream>
+#include <list>
+#include <memory>
+#include <memory_resource>
+#include <random>
+#include <string>
+#include <vector>
+
+// Benchmark for the sorting engines: every engine on every input size and distribution, with warm-up runs
+// and repeated trials, against std::sort and std::stable_sort. The selection engines only take the --top
+// smallest elements, in order, and are compared with std::partial_sort and std::nth_element
+
+namespace
+{
+
+using Clock = std::chrono::steady_clock;
+
+enum class Distribution
+{
+    Random,
+    Sorted,
+    Reversed,
+    OrganPipe,    // Ascending, then descending
+    FewUnique,    // Only FEW_UNIQUE_VALUES distinct values
+    NearlySorted, // Sorted, then about 1% of the elements swapped at random
+};
+
+enum class Engine
+{
+    Vector,      // PmergeMe::sort on std::vector (Ford-Johnson)
+    Adaptive,    // PmergeMe::sortAdaptive on std::vector (runs of presorted input merged, Ford-Johnson otherwise)
+    List,        // PmergeMe::sort on std::list (Ford-Johnson)
+    ListArena,   // Same on a std::pmr::list whose nodes come from a PmergeMe::ListArena
+    Parallel,    // PmergeMe::sortParallel (only with --threads)
+    Radix,       // PmergeMe::radixSort
+    StdSort,     // std::sort
+    StableSort,  // std::stable_sort
+    Smallest,    // PmergeMe::smallest (only with --engines)
+    PartialSort, // std::partial_sort (only with --engines)
+    NthElement,  // std::nth_element, then std::sort of the smallest (only with --engines)
+};
+
+enum class Format
+{
+    Table,
+    Csv,
+    Json,
+};
+
+struct Options
+{
+    std::vector<std::size_t>  sizes{ 100, 1'000, 10'000, 100'000, 1'000'000 };
+    std::vector<Distribution> distributions{ Distribution::Random,    Distribution::Sorted,
+                                             Distribution::Reversed,  Distribution::OrganPipe,
+                                             Distribution::FewUnique, Distribution::NearlySorted };
+    std::vector<Engine>       engines{ Engine::Vector, Engine::Adaptive, Engine::List,      Engine::ListArena,
+                                 Engine::Radix,  Engine::StdSort,  Engine::StableSort };
+    int                       warmup{ 1 };
+    int                       repeat{ 7 };
+    std::uint32_t             seed{ 42 };
+    unsigned                  threads{ 0 }; // Also time sortParallel if set
+    std::size_t               top{ 100 };   // Elements taken by the selection engines
+    Format                    format{ Format::Table };
+};
+
+constexpr int FEW_UNIQUE_VALUES{ 16 };
+
+const char* distributionName( Distribution distribution )
+{
+    if ( distribution == Distribution::Sorted )
+        return "sorted";
+    if ( distribution == Distribution::Reversed )
+        return "reversed";
+    if ( distribution == Distribution::OrganPipe )
+        return "organ-pipe";
+    if ( distribution == Distribution::FewUnique )
+        return "few-unique";
+    if ( distribution == Distribution::NearlySorted )
+        return "nearly-sorted";
+    return "random";
+}
+
+const char* engineName( Engine engine )
+{
+    if ( engine == Engine::Vector )
+        return "vector";
+    if ( engine == Engine::Adaptive )
+        return "adaptive";
+    if ( engine == Engine::List )
+        return "list";
+    if ( engine == Engine::ListArena )
+        return "list-arena";
+    if ( engine == Engine::Parallel )
+        return "parallel";
+    if ( engine == Engine::Radix )
+        return "radix";
+    if ( engine == Engine::StdSort )
+        return "std-sort";
+    if ( engine == Engine::StableSort )
+        return "std-stable-sort";
+    if ( engine == Engine::Smallest )
+        return "smallest";
+    if ( engine == Engine::PartialSort )
+        return "std-partial-sort";
+    return "std-nth-element";
+}
+
+// Non-negative values, like the input of PmergeMe
+std::vector<int> generateInput( std::size_t size, Distribution distribution, std::mt19937& rng )
+{
+    std::vector<int>                   values( size );
+    std::uniform_int_distribution<int> any_value{ 0, 1'000'000'000 };
+
+    if ( distribution == Distribution::FewUnique )
+    {
+        std::uniform_int_distribution<int> few{ 0, FEW_UNIQUE_VALUES - 1 };
+        for ( auto& value : values )
+            value = few( rng );
+        return values;
+    }
+
+    for ( auto& value : values )
+        value = any_value( rng );
+    if ( distribution == Distribution::Random )
+        return values;
+
+    std::sort( values.begin(), values.end() );
+    if ( distribution == Distribution::Reversed )
+        std::reverse( values.begin(), values.end() );
+    else if ( distribution == Distribution::OrganPipe )
+        std::reverse( values.begin() + static_cast<std::ptrdiff_t>( size / 2 ), values.end() );
+    else if ( distribution == Distribution::NearlySorted && size > 1 )
+    {
+        std::uniform_int_distribution<std::size_t> position{ 0, size - 1 };
+        for ( std::size_t i{ 0 }; i < size / 100 + 1; ++i )
+            std::swap( values[position( rng )], values[position( rng )] );
+    }
+
+    return values;
+}
+
+// Build a list of input, sort it and free it; the nodes are part of the cost of a list, so all of it is timed
+template <typename List, typename... Resource>
+double timeList( const std::vector<int>& input, bool& sorted, Resource&... resource )
+{
+    auto begin{ Clock::now() };
+    {
+        List lst( input.begin(), input.end(), &resource... );
+        PmergeMe::sort( lst );
+        sorted = sorted && std::is_sorted( lst.begin(), lst.end() );
+    }
+    return std::chrono::duration<double>( Clock::now() - begin ).count();
+}
+
+// One timed run of a selection engine on a copy of input, which is not timed; sorted is cleared unless the
+// result is the top smallest elements in order
+double timeSelection( Engine engine, const std::vector<int>& input, std::size_t top, bool& sorted )
+{
+    top = std::min( top, input.size() );
+    auto middle{ static_cast<std::ptrdiff_t>( top ) };
+
+    std::vector<int> vec{ input };
+    std::vector<int> smallest;
+    auto             begin{ Clock::now() };
+    if ( engine == Engine::Smallest )
+        smallest = PmergeMe::smallest( vec, top );
+    else
+    {
+        if ( engine == Engine::PartialSort )
+            std::partial_sort( vec.begin(), vec.begin() + middle, vec.end() );
+        else
+        {
+            std::nth_element( vec.begin(), vec.begin() + middle, vec.end() );
+            std::sort( vec.begin(), vec.begin() + middle );
+        }
+        smallest.assign( vec.begin(), vec.begin() + middle );
+    }
+    double seconds{ std::chrono::duration<double>( Clock::now() - begin ).count() };
+
+    std::vector<int> expected( top );
+    std::partial_sort_copy( input.begin(), input.end(), expected.begin(), expected.end() );
+    sorted = sorted && smallest == expected;
+    return seconds;
+}
+
+// One timed run of engine on a copy of input (the copy is not timed, except for lists, see timeList());
+// sorted is cleared if the result is not
+double timeEngine( Engine engine, const std::vector<int>& input, const Options& options, WorkStealingPool* pool,
+                   bool& sorted )
+{
+    if ( engine == Engine::Smallest || engine == Engine::PartialSort || engine == Engine::NthElement )
+        return timeSelection( engine, input, options.top, sorted );
+    if ( engine == Engine::List )
+        return timeList<std::list<int>>( input, sorted );
+    if ( engine == Engine::ListArena )
+    {
+        PmergeMe::ListArena arena{ input.size() };
+        return timeList<std::pmr::list<int>>( input, sorted, arena );
+    }
+
+    std::vector<int> vec{ input };
+    auto             begin{ Clock::now() };
+    if ( engine == Engine::Vector )
+        PmergeMe::sort( vec );
+    else if ( engine == Engine::Adaptive )
+        PmergeMe::sortAdaptive( vec );
+    else if ( engine == Engine::Parallel )
+        PmergeMe::sortParallel( vec.begin(), vec.end(), *pool );
+    else if ( engine == Engine::Radix )
+        PmergeMe::radixSort( vec );
+    else if ( engine == Engine::StdSort )
+        std::sort( vec.begin(), vec.end() );
+    else
+        std::stable_sort( vec.begin(), vec.end() );
+    double seconds{ std::chrono::duration<double>( Clock::now() - begin ).count() };
+    sorted = sorted && std::is_sorted( vec.begin(), vec.end() );
+    return seconds;
+}
+
+struct Result
+{
+    Engine       engine;
+    Distribution distribution;
+    std::size_t  size;
+    int          trials;
+    double       median; // Seconds
+    double       p95;    // Seconds, nearest rank
+    bool         sorted;
+};
+
+Result measure( Engine engine, Distribution distribution, const std::vector<int>& input, const Options& options,
+                WorkStealingPool* pool )
+{
+    bool sorted{ true };
+    for ( int i{ 0 }; i < options.warmup; ++i )
+        timeEngine( engine, input, options, pool, sorted );
+
+    // Scale repetitions down for huge inputs so the suite finishes in reasonable time
+    int repeat{ input.size() >= 1'000'000 ? std::max( 3, options.repeat / 2 ) : options.repeat };
+
+    std::vector<double> times;
+    for ( int i{ 0 }; i < repeat; ++i )
+        times.push_back( timeEngine( engine, input, options, pool, sorted ) );
+
+    std::sort( times.begin(), times.end() );
+    std::size_t p95_rank{ ( times.size() * 95 + 99 ) / 100 };
+    return { engine, distribution, input.size(), repeat, times[times.size() / 2], times[p95_rank - 1], sorted };
+}
+
+void printHeader( const Options& options )
+{
+    if ( options.format == Format::Csv )
+        std::cout << "engine,distribution,size,trials,median_ms,p95_ms,melements_per_s,sorted\n";
+    else if ( options.format == Format::Json )
+        std::cout << "[\n";
+    else
+    {
+        // Sizes from 1M run fewer trials, so every row gives its own count
+        std::cout << "Median and p95 of the runs after " << options.warmup << " warm-up run(s)\n";
+        std::cout << std::left << std::setw( 17 ) << "engine" << std::setw( 15 ) << "distribution" << std::right
+                  << std::setw( 10 ) << "size" << std::setw( 6 ) << "runs" << std::setw( 14 ) << "median (ms)" << std::setw( 12 ) << "p95 (ms)"
+                  << std::setw( 14 ) << "Melements/s" << '\n';
+    }
+}
+
+void printResult( const Result& result, const Options& options, bool first )
+{
+    double elements_per_second{ result.median > 0 ? result.size / result.median : 0.0 };
+
+    if ( options.format == Format::Csv )
+        std::cout << engineName( result.engine ) << ',' << distributionName( result.distribution ) << ','
+                  << result.size << ',' << result.trials << ',' << std::fixed << std::setprecision( 4 )
+                  << result.median * 1e3 << ',' << result.p95 * 1e3 << ',' << elements_per_second / 1e6 << ','
+                  << ( result.sorted ? "true" : "false" ) << '\n';
+    else if ( options.format == Format::Json )
+        std::cout << ( first ? "  " : ",\n  " ) << "{\"engine\": \"" << engineName( result.engine )
+                  << "\", \"distribution\": \"" << distributionName( result.distribution )
+                  << "\", \"size\": " << result.size << ", \"trials\": " << result.trials << ", \"median_ms\": "
+                  << std::fixed << std::setprecision( 4 ) << result.median * 1e3
+                  << ", \"p95_ms\": " << result.p95 * 1e3 << ", \"melements_per_s\": " << elements_per_second / 1e6
+                  << ", \"sorted\": " << ( result.sorted ? "true" : "false" ) << '}';
+    else
+        std::cout << std::left << std::setw( 17 ) << engineName( result.engine ) << std::setw( 15 )
+                  << distributionName( result.distribution ) << std::right << std::setw( 10 ) << result.size
+                  << std::setw( 6 ) << result.trials << std::setw( 14 ) << std::fixed << std::setprecision( 3 ) << result.median * 1e3
+                  << std::setw( 12 ) << result.p95 * 1e3 << std::setw( 14 ) << std::setprecision( 2 )
+                  << elements_per_second / 1e6 << ( result.sorted ? "" : "  NOT SORTED" ) << '\n';
+}
+
+// Return whether every engine sorted every input (or selected the right elements)
+bool bench( const Options& options )
+{
+    std::unique_ptr<WorkStealingPool> pool;
+    if ( options.threads > 0 )
+        pool = std::make_unique<WorkStealingPool>( options.threads );
+
+    std::vector<Engine> engines{ options.engines };
+    if ( pool && std::find( engines.begin(), engines.end(), Engine::Parallel ) == engines.end() )
+        engines.insert( engines.begin() + 1, Engine::Parallel );
+
+    printHeader( options );
+
+    std::mt19937 rng{ options.seed };
+    bool         all_sorted{ true };
+    bool         first{ true };
+    for ( auto distribution : options.distributions )
+    {
+        for ( auto size : options.sizes )
+        {
+            // Every engine sorts the same input
+            std::vector<int> input{ generateInput( size, distribution, rng ) };
+            for ( auto engine : engines )
+            {
+                if ( engine == Engine::Parallel && !pool )
+                    continue;
+
+                Result result{ measure( engine, distribution, input, options, pool.get() ) };
+                printResult( result, options, first );
+                all_sorted = all_sorted && result.sorted;
+                first      = false;
+            }
+        }
+    }
+
+    if ( options.format == Format::Json )
+        std::cout << "\n]\n";
+    return all_sorted;
+}
+
+std::vector<std::string> splitList( const std::string& arg )
+{
+    std::vector<std::string> items;
+    std::size_t              pos{ 0 };
+
+    while ( pos < arg.size() )
+    {
+        std::size_t end{ arg.find( ',', pos ) };
+        if ( end == std::string::npos )
+            end = arg.size();
+        items.push_back( arg.substr( pos, end - pos ) );
+        pos = end + 1;
+    }
+
+    return items;
+}
+
+std::vector<Distribution> parseDistributions( const std::string& arg )
+{
+    const std::vector<Distribution> all{ Options{}.distributions };
+
+    std::vector<Distribution> distributions;
+    for ( const auto& name : splitList( arg ) )
+    {
+        auto found{ std::find_if( all.begin(), all.end(),
+                                  [&]( Distribution d ) { return name == distributionName( d ); } ) };
+        if ( found == all.end() )
+            throw std::invalid_argument( "unknown distribution " + name );
+        distributions.push_back( *found );
+    }
+    return distributions;
+}
+
+std::vector<Engine> parseEngines( const std::string& arg )
+{
+    const std::vector<Engine> all{ Engine::Vector,     Engine::Adaptive,    Engine::List,      Engine::ListArena,
+                                   Engine::Parallel,   Engine::Radix,       Engine::StdSort,   Engine::StableSort,
+                                   Engine::Smallest,   Engine::PartialSort, Engine::NthElement };
+
+    std::vector<Engine> engines;
+    for ( const auto& name : splitList( arg ) )
+    {
+        auto found{ std::find_if( all.begin(), all.end(), [&]( Engine e ) { return name == engineName( e ); } ) };
+        if ( found == all.end() )
+            throw std::invalid_argument( "unknown engine " + name );
+        engines.push_back( *found );
+    }
+    return engines;
+}
+
+void usage()
+{
+    std::cerr << "Usage: ./PmergeMe_bench [--sizes N,N,...] [--dist NAME,...] [--engines NAME,...] [--warmup N]\n"
+                 "                        [--repeat N] [--seed N] [--threads N] [--top N] [--format table|csv|json]\n"
+                 "  distributions: random, sorted, reversed, organ-pipe, few-unique, nearly-sorted\n"
+                 "  engines: vector, adaptive, list, list-arena, parallel, radix, std-sort, std-stable-sort\n"
+                 "  selection engines (the --top smallest, 100 by default): smallest, std-partial-sort,\n"
+                 "                     std-nth-element\n";
+}
+
+} // namespace
+
+int main( int argc, char** argv )
+{
+    Options options;
+
+    try
+    {
+        for ( int i{ 1 }; i < argc; ++i )
+        {
+            std::string arg{ argv[i] };
+            if ( i + 1 >= argc )
+                throw std::invalid_argument( "missing value for " + arg );
+            std::string value{ argv[++i] };
+
+            if ( arg == "--sizes" )
+            {
+                options.sizes.clear();
+                for ( const auto& size : splitList( value ) )
+                    options.sizes.push_back( std::stoul( size ) );
+            }
+            else if ( arg == "--dist" )
+                options.distributions = parseDistributions( value );
+            else if ( arg == "--engines" )
+                options.engines = parseEngines( value );
+            else if ( arg == "--warmup" )
+                options.warmup = std::max( 0, std::stoi( value ) );
+            else if ( arg == "--repeat" )
+                options.repeat = std::max( 1, std::stoi( value ) );
+            else if ( arg == "--seed" )
+                options.seed = static_cast<std::uint32_t>( std::stoul( value ) );
+            else if ( arg == "--threads" )
+                options.threads = static_cast<unsigned>( std::stoul( value ) );
+            else if ( arg == "--top" )
+                options.top = std::stoul( value );
+            else if ( arg == "--format" )
+            {
+                if ( value == "table" )
+                    options.format = Format::Table;
+                else if ( value == "csv" )
+                    options.format = Format::Csv;
+                else if ( value == "json" )
+                    options.format = Format::Json;
+                else
+                    throw std::invalid_argument( "unknown format " + value );
+            }
+            else
+                throw std::invalid_argument( "unknown option " + arg );
+        }
+    }
+    catch ( const std::exception& e )
+    {
+        std::cerr << "Error: " << e.what() << '\n';
+        usage();
+        return 1;
+    }
+
+    if ( !bench( options ) )
+    {
+        std::cerr << "Error: some engine did not sort its input" << '\n';
+        return 1;
+    }
+
+    return 0;
+}
@@ -1,52 +1,369 @@
+#include "ExternalSort.hpp"
+#include "OutputBuffer.hpp"
 #include "PmergeMe.hpp"
 #include <chrono>
 #include <iomanip>
+#include <memory>
+#include <sstream>
+#include <string_view>
 
 int main( int argc, char** argv )
 {
-    if ( argc < 2 )
+    // Options come before the numbers
+    bool        print_count{ false };
+    bool        use_radix{ false };
+    bool        binary_output{ false };
+    bool        profile{ false };
+    bool        use_arena{ false };
+    bool        adaptive{ false };
+    bool        read_ahead{ false };
+    std::size_t external_memory{ 0 };
+    std::size_t top{ 0 };
+    const char* file_path{ nullptr };
+    unsigned    threads{ 0 };
+    int         option_count{ 0 };
+    while ( option_count + 1 < argc && std::string_view{ argv[option_count + 1] }.substr( 0, 2 ) == "--" )
     {
-        std::cout << "Usage: ./PmergeMe <a list of integers>" << '\n';
+        std::string_view option{ argv[++option_count] };
+        if ( option == "--count" )
+            print_count = true;
+        else if ( option == "--threads" )
+        {
+            try
+            {
+                threads = option_count + 1 < argc ? static_cast<unsigned>( std::stoul( argv[++option_count] ) ) : 0;
+            }
+            catch ( const std::exception& )
+            {
+                threads = 0;
+            }
+            if ( threads == 0 )
+            {
+                std::cerr << "Error: --threads needs a positive number of threads" << '\n';
+                return 1;
+            }
+        }
+        else if ( option == "--algo" )
+        {
+            std::string_view algo{ option_count + 1 < argc ? argv[++option_count] : "" };
+            if ( algo != "ford-johnson" && algo != "radix" )
+            {
+                std::cerr << "Error: --algo needs ford-johnson or radix" << '\n';
+                return 1;
+            }
+            use_radix = algo == "radix";
+        }
+        else if ( option == "--file" )
+        {
+            if ( option_count + 1 == argc )
+            {
+                std::cerr << "Error: --file needs a path, or - for the standard input" << '\n';
+                return 1;
+            }
+            file_path = argv[++option_count];
+        }
+        else if ( option == "--binary" )
+            binary_output = true;
+        else if ( option == "--arena" )
+            use_arena = true;
+        else if ( option == "--adaptive" )
+            adaptive = true;
+        else if ( option == "--external" )
+        {
+            external_memory = option_count + 1 < argc ? ExternalSort::parseMemorySize( argv[++option_count] ) : 0;
+            if ( external_memory == 0 )
+            {
+                std::cerr << "Error: --external needs a memory limit of at least 16M (bytes, or with a K, M or G suffix)"
+                          << '\n';
+                return 1;
+            }
+        }
+        else if ( option == "--read-ahead" )
+            read_ahead = true;
+        else if ( option == "--top" )
+        {
+            try
+            {
+                top = option_count + 1 < argc ? std::stoul( argv[++option_count] ) : 0;
+            }
+            catch ( const std::exception& )
+            {
+                top = 0;
+            }
+            if ( top == 0 )
+            {
+                std::cerr << "Error: --top needs a positive number of elements" << '\n';
+                return 1;
+            }
+        }
+        else if ( option == "--profile" )
+        {
+#ifdef PMERGEME_PROFILE
+            profile = true;
+#else
+            std::cerr << "Error: --profile needs a build with profiling (make re PROFILE=1)" << '\n';
+            return 1;
+#endif
+        }
+        else
+        {
+            std::cerr << "Error: unknown option " << option << '\n';
+            return 1;
+        }
+    }
+
+    // From here on, argv[1] is the first number
+    argc -= option_count;
+    argv += option_count;
+
+    if ( ( external_memory > 0 || read_ahead ) && ( !file_path || argc > 1 ) )
+    {
+        std::cerr << "Error: --external and --read-ahead only work with --file, without numbers in the arguments"
+                  << '\n';
+        return 1;
+    }
+    if ( read_ahead && external_memory == 0 )
+    {
+        std::cerr << "Error: --read-ahead needs --external" << '\n';
+        return 1;
+    }
+    // The SIMD kernels of the parallel engine compare without counting
+    if ( print_count && threads > 0 )
+    {
+        std::cerr << "Error: --count does not work with --threads" << '\n';
+        return 1;
+    }
+    if ( top > 0 && ( threads > 0 || use_radix || use_arena || adaptive || external_memory > 0 ) )
+    {
+        std::cerr << "Error: --top does not work with --threads, --algo radix, --arena, --adaptive or --external"
+                  << '\n';
+        return 1;
+    }
+
+    // The numbers come either from the arguments or from a file
+    if ( ( argc < 2 ) == !file_path )
+    {
+        std::cout << "Usage: ./PmergeMe [options] <a list of integers>" << '\n';
+        std::cout << "       ./PmergeMe [options] --file <file of integers, or - for the standard input>" << '\n';
+        std::cout << "Options: --count, --threads <count>, --algo ford-johnson|radix, --arena, --adaptive, --binary,"
+                  << " --profile" << '\n';
+        std::cout << "         --external <memory limit> [--read-ahead] (with --file: sorted numbers only)" << '\n';
+        std::cout << "         --top <k> (only the k smallest numbers, without sorting the others)" << '\n';
         return 1;
     }
 
     try
     {
+        // With --profile, the phases of every step are printed after the timings
+        std::ostringstream profile_report;
+        auto               take_profile{ [&]( const char* title ) {
+            if ( profile )
+            {
+                profile_report << title << ":\n";
+                Profiler::report( profile_report );
+            }
+        } };
+        if ( profile )
+            Profiler::enable();
+
+        // An external sort streams the file through bounded memory instead: the standard output only gets the
+        // sorted numbers, and the chunks are sorted with the engine picked by --algo
+        if ( external_memory > 0 )
+        {
+            PmergeMe::Timer timer;
+            ExternalSort    sorter{ external_memory, use_radix, read_ahead };
+            sorter.sortFile( file_path );
+
+            OutputBuffer out;
+            sorter.merge( out, binary_output );
+            out.flush();
+            auto time_external_sort{ timer.elapsed() };
+            take_profile( "Phases of the external sort" );
+
+            std::cerr << "Time to process a range of " << sorter.size() << " elements externally ("
+                      << sorter.runCount() << " runs): " << std::fixed << std::setprecision( 2 ) << time_external_sort
+                      << " microseconds" << '\n';
+            std::cerr << profile_report.str();
+            return 0;
+        }
+
+        // A file is read once, untimed; every engine then starts from a copy of its numbers, just like it
+        // starts from converting argv otherwise
+        std::vector<int> file_numbers;
+        if ( file_path )
+        {
+            file_numbers = PmergeMe::readNumbers( file_path );
+            take_profile( "Phases of reading the file" );
+        }
+
+        auto vector_input{ [&]() { return file_path ? file_numbers : parseArgs<std::vector<int>>( argc, argv ); } };
+        auto list_input{ [&]() {
+            return file_path ? std::list<int>( file_numbers.begin(), file_numbers.end() )
+                             : parseArgs<std::list<int>>( argc, argv );
+        } };
+
+        OutputBuffer out;
+        auto         print_before{ [&]() {
+            out << "Before: ";
+            if ( file_path )
+                for ( int number : file_numbers )
+                    out << number << ' ';
+            else
+                for ( int i{ 1 }; argv[i]; ++i )
+                    out << argv[i] << ' ';
+            out << '\n';
+        } };
+
         // Instantiating Timer class starts the timer
         PmergeMe::Timer timer;
 
-        // Sort using std::vector
-        std::vector vec{ PmergeMe::sortVector( argc, argv ) };
+        // With --top, the smallest numbers are picked out of a std::vector instead, and nothing else is sorted
+        if ( top > 0 )
+        {
+            std::vector vec{ vector_input() };
+            std::vector smallest{ PmergeMe::smallest( vec, top ) };
+            auto        time_selection{ timer.elapsed() };
+            take_profile( "Phases of the selection" );
+
+            if ( binary_output )
+                out.writeBinary( smallest.data(), smallest.size() * sizeof( int ) );
+            else
+            {
+                print_before();
+                out << "Smallest: ";
+                for ( const auto& elem : smallest )
+                    out << elem << ' ';
+                out << '\n';
+            }
+            out.flush();
+
+            std::ostream& report{ binary_output ? std::cerr : std::cout };
+            report << "Time to select the " << smallest.size() << " smallest of a range of " << vec.size()
+                   << " elements with std::vector: " << std::fixed << std::setprecision( 2 ) << time_selection
+                   << " microseconds" << '\n';
+            if ( print_count )
+                report << "Comparisons with std::vector: " << PmergeMe::comparisons()
+                       << " (worst case: " << PmergeMe::selectionBound( vec.size(), top ) << ")\n";
+            report << profile_report.str();
+            return 0;
+        }
+
+        // Sort using std::vector, in parallel if asked to (the threads are started before timing)
+        // With --adaptive, presorted input is merged from its runs, outside the Ford-Johnson comparison bound
+        std::unique_ptr<WorkStealingPool> pool;
+        if ( threads > 0 )
+        {
+            pool = std::make_unique<WorkStealingPool>( threads );
+            timer.reset();
+        }
+        std::vector vec{ vector_input() };
+        if ( pool )
+            PmergeMe::sortParallel( vec.begin(), vec.end(), *pool );
+        else if ( adaptive )
+            PmergeMe::sortAdaptive( vec );
+        else
+            PmergeMe::sort( vec );
 
         // Calculate time to sort using std::vector
         auto time_vec_sort{ timer.elapsed() };
+        take_profile( "Phases with std::vector" );
 
         // Reset the timer
         timer.reset();
 
         // Sort using std::list
-        std::list lst{ PmergeMe::sortList( argc, argv ) };
+        std::list lst{ list_input() };
+        if ( adaptive )
+            PmergeMe::sortAdaptive( lst );
+        else
+            PmergeMe::sort( lst );
 
         // Calculate time to sort using std::list
         auto time_list_sort{ timer.elapsed() };
+        take_profile( "Phases with std::list" );
 
-        // Print unsorted numbers
-        std::cout << "Before: ";
-        for ( int i{ 1 }; argv[i]; ++i )
-            std::cout << argv[i] << ' ';
-        std::cout << '\n';
+        // Also sort a std::pmr::list whose nodes come from one arena if asked to (the arena is freed with it)
+        double time_arena_sort{ 0 };
+        if ( use_arena )
+        {
+            std::size_t count{ file_path ? file_numbers.size() : static_cast<std::size_t>( argc - 1 ) };
 
-        // Print sorted numbers
-        std::cout << "After: ";
-        for ( const auto& elem : vec )
-            std::cout << elem << ' ';
-        std::cout << '\n';
+            timer.reset();
+            PmergeMe::ListArena arena{ count };
+            std::pmr::list<int> arena_lst{ file_path ? std::pmr::list<int>( file_numbers.begin(), file_numbers.end(),
+                                                                            &arena )
+                                                     : parseArgs( argc, argv, std::pmr::list<int>{ &arena } ) };
+            if ( adaptive )
+                PmergeMe::sortAdaptive( arena_lst );
+            else
+                PmergeMe::sort( arena_lst );
+            time_arena_sort = timer.elapsed();
+            take_profile( "Phases with std::pmr::list (arena)" );
+
+            if ( !std::equal( arena_lst.begin(), arena_lst.end(), vec.begin(), vec.end() ) )
+            {
+                std::cerr << "Error: std::pmr::list and std::vector results differ" << '\n';
+                return 1;
+            }
+        }
+
+        // Also sort with the radix engine if asked to; it must agree with Ford-Johnson
+        double time_radix_sort{ 0 };
+        if ( use_radix )
+        {
+            timer.reset();
+            std::vector radix{ vector_input() };
+            PmergeMe::radixSort( radix );
+            time_radix_sort = timer.elapsed();
+            take_profile( "Phases with radix sort" );
+
+            if ( radix != vec )
+            {
+                std::cerr << "Error: radix sort and Ford-Johnson results differ" << '\n';
+                return 1;
+            }
+        }
+
+        if ( binary_output )
+        {
+            // Only the sorted numbers, as raw ints in native byte order
+            out.writeBinary( vec.data(), vec.size() * sizeof( int ) );
+        }
+        else
+        {
+            // Print unsorted numbers
+            print_before();
+
+            // Print sorted numbers
+            out << "After: ";
+            for ( const auto& elem : vec )
+                out << elem << ' ';
+            out << '\n';
+        }
+        out.flush();
+
+        // With binary output, the standard output only holds the numbers
+        std::ostream& report{ binary_output ? std::cerr : std::cout };
 
         // Print times to sort
-        std::cout << "Time to process a range of " << vec.size() << " elements with std::vector: " << std::fixed
-                  << std::setprecision( 2 ) << time_vec_sort << " microseconds" << '\n';
-        std::cout << "Time to process a range of " << lst.size() << " elements with std::list: " << std::fixed
-                  << std::setprecision( 2 ) << time_list_sort << " microseconds" << '\n';
+        report << "Time to process a range of " << vec.size() << " elements with std::vector: " << std::fixed
+               << std::setprecision( 2 ) << time_vec_sort << " microseconds" << '\n';
+        report << "Time to process a range of " << lst.size() << " elements with std::list: " << std::fixed
+               << std::setprecision( 2 ) << time_list_sort << " microseconds" << '\n';
+        if ( use_arena )
+            report << "Time to process a range of " << vec.size() << " elements with std::pmr::list (arena): "
+                   << std::fixed << std::setprecision( 2 ) << time_arena_sort << " microseconds" << '\n';
+        if ( use_radix )
+            report << "Time to process a range of " << vec.size() << " elements with radix sort: " << std::fixed
+                   << std::setprecision( 2 ) << time_radix_sort << " microseconds" << '\n';
+
+        if ( print_count )
+            report << "Comparisons with std::vector: " << PmergeMe::comparisons()
+                   << ( adaptive ? " (adaptive, so not bound by the Ford-Johnson worst case: "
+                                          : " (Ford-Johnson worst case: " )
+                   << PmergeMe::comparisonBound( vec.size() ) << ")\n";
+
+        report << profile_report.str();
     }
     catch ( const std::exception& e )
     {
@@ -0,0 +1,392 @@
+#include "ExternalSort.hpp"
+#include "PmergeMe.hpp"
+#include <algorithm>
+#include <array>
+#include <cstdlib> // mkstemp
+#include <deque>
+#include <fcntl.h> // open
+#include <iostream>
+#include <list>
+#include <random>
+#include <stdexcept> // std::runtime_error
+#include <string>
+#include <sys/resource.h> // getrusage
+#include <thread>
+#include <unistd.h> // dup, dup2, pread, unlink, close
+#include <utility>
+#include <vector>
+
+// Checks of the sorting engines: every result must be the sorted input, and the comparisons made by the
+// random-access engines (comparisons()) must stay within the worst case F(n) = PmergeMe::comparisonBound( n ),
+// for every n up to MAX_EVERY_SIZE and a few larger sizes, on several distributions of input. The input of files
+// and the external sort are checked on their own
+
+namespace
+{
+
+enum class Distribution
+{
+    Random,
+    Duplicates, // Only DUPLICATE_VALUES distinct values
+    Sorted,
+    Reversed,
+    Signed, // Negative and positive values
+};
+
+constexpr std::size_t MAX_EVERY_SIZE{ 1'000 };
+constexpr std::size_t LARGE_SIZES[]{ 2'048, 4'097, 10'000, PmergeMe::PARALLEL_THRESHOLD + 1, 100'000 };
+constexpr int         DUPLICATE_VALUES{ 4 };
+constexpr std::size_t SELECTION_COUNTS[]{ 1, 2, 10, 100 };
+constexpr unsigned    POOL_THREADS{ 4 };
+
+// Numbers of the external sort, which has a file of them cut by the end of the first block it reads
+constexpr std::size_t EXTERNAL_SIZE{ 600'000 };
+constexpr std::size_t READ_BLOCK_SIZE{ 1 << 20 };
+
+// Records sorted by key, which remember where they were to check stability
+struct Record
+{
+    int         key;
+    std::size_t index;
+};
+
+const char* distributionName( Distribution distribution )
+{
+    if ( distribution == Distribution::Duplicates )
+        return "duplicates";
+    if ( distribution == Distribution::Sorted )
+        return "sorted";
+    if ( distribution == Distribution::Reversed )
+        return "reversed";
+    if ( distribution == Distribution::Signed )
+        return "signed";
+    return "random";
+}
+
+std::vector<int> generateInput( std::size_t size, Distribution distribution, std::mt19937& rng )
+{
+    std::vector<int>                   values( size );
+    std::uniform_int_distribution<int> any_value{ 0, 1'000'000'000 };
+    std::uniform_int_distribution<int> any_sign{ -1'000'000'000, 1'000'000'000 };
+    std::uniform_int_distribution<int> few{ 0, DUPLICATE_VALUES - 1 };
+
+    for ( auto& value : values )
+    {
+        if ( distribution == Distribution::Duplicates )
+            value = few( rng );
+        else
+            value = distribution == Distribution::Signed ? any_sign( rng ) : any_value( rng );
+    }
+    if ( distribution == Distribution::Sorted )
+        std::sort( values.begin(), values.end() );
+    else if ( distribution == Distribution::Reversed )
+        std::sort( values.begin(), values.end(), std::greater<>{} );
+    return values;
+}
+
+// Failed checks are printed as they happen, and counted
+class Checker
+{
+  public:
+    void check( bool ok, const std::string& what, std::size_t size, Distribution distribution )
+    {
+        ++m_checks;
+        if ( ok )
+            return;
+        ++m_failures;
+        std::cerr << "FAILED: " << what << " (n = " << size << ", " << distributionName( distribution ) << ")\n";
+    }
+
+    int report() const
+    {
+        std::cout << m_checks - m_failures << " of " << m_checks << " checks passed" << '\n';
+        return m_failures == 0 ? 0 : 1;
+    }
+
+  private:
+    std::size_t m_checks{ 0 };
+    std::size_t m_failures{ 0 };
+};
+
+// One input through every engine
+void checkSize( Checker& checker, const std::vector<int>& input, Distribution distribution, WorkStealingPool& pool )
+{
+    std::size_t      size{ input.size() };
+    std::size_t      bound{ PmergeMe::comparisonBound( size ) };
+    std::vector<int> expected{ input };
+    std::sort( expected.begin(), expected.end() );
+
+    std::vector<int> vec{ input };
+    PmergeMe::sort( vec );
+    checker.check( vec == expected, "std::vector sorted", size, distribution );
+    checker.check( PmergeMe::comparisons() <= bound, "std::vector comparisons within F(n)", size, distribution );
+
+    std::deque<int> deq( input.begin(), input.end() );
+    PmergeMe::sort( deq );
+    checker.check( std::equal( deq.begin(), deq.end(), expected.begin(), expected.end() ), "std::deque sorted", size,
+                   distribution );
+    checker.check( PmergeMe::comparisons() <= bound, "std::deque comparisons within F(n)", size, distribution );
+
+    // The list engine merge sorts its pairs, so only its result is checked
+    std::list<int> lst( input.begin(), input.end() );
+    PmergeMe::sort( lst );
+    checker.check( std::equal( lst.begin(), lst.end(), expected.begin(), expected.end() ), "std::list sorted", size,
+                   distribution );
+
+    // The adaptive engines, the parallel one (which takes the SIMD kernels with ints compared by <, from
+    // PARALLEL_THRESHOLD elements) and radix sort are not bound by F(n): only their results are checked
+    std::vector<int> adaptive_vec{ input };
+    PmergeMe::sortAdaptive( adaptive_vec );
+    checker.check( adaptive_vec == expected, "std::vector sorted by sortAdaptive()", size, distribution );
+
+    std::list<int> adaptive_lst( input.begin(), input.end() );
+    PmergeMe::sortAdaptive( adaptive_lst );
+    checker.check( std::equal( adaptive_lst.begin(), adaptive_lst.end(), expected.begin(), expected.end() ),
+                   "std::list sorted by sortAdaptive()", size, distribution );
+
+    std::vector<int> parallel_vec{ input };
+    PmergeMe::sortParallel( parallel_vec.begin(), parallel_vec.end(), pool );
+    checker.check( parallel_vec == expected, "std::vector sorted by sortParallel()", size, distribution );
+
+    std::vector<int> radix_vec{ input };
+    PmergeMe::radixSort( radix_vec );
+    checker.check( radix_vec == expected, "std::vector sorted by radixSort()", size, distribution );
+
+    // Records with equal keys must keep their order with stableSortByKey(), as with std::stable_sort; with
+    // sortByKey() they only have to be sorted by key
+    std::vector<Record> records( size );
+    for ( std::size_t i{ 0 }; i < size; ++i )
+        records[i] = { input[i], i };
+    auto by_key{ []( const Record& a, const Record& b ) { return a.key < b.key; } };
+    auto same_record{ []( const Record& a, const Record& b ) { return a.key == b.key && a.index == b.index; } };
+    std::vector<Record> expected_records{ records };
+    std::stable_sort( expected_records.begin(), expected_records.end(), by_key );
+
+    std::vector<Record> stable_records{ records };
+    PmergeMe::stableSortByKey( stable_records, &Record::key );
+    checker.check( std::equal( stable_records.begin(), stable_records.end(), expected_records.begin(),
+                               expected_records.end(), same_record ),
+                   "stableSortByKey() same as std::stable_sort", size, distribution );
+
+    std::vector<Record> key_records{ records };
+    PmergeMe::sortByKey( key_records, &Record::key );
+    bool keys_sorted{ std::equal( key_records.begin(), key_records.end(), expected.begin(), expected.end(),
+                                  []( const Record& record, int key ) { return record.key == key; } ) };
+    std::stable_sort( key_records.begin(), key_records.end(),
+                      []( const Record& a, const Record& b ) { return a.index < b.index; } );
+    checker.check( keys_sorted && std::equal( key_records.begin(), key_records.end(), records.begin(),
+                                              records.end(), same_record ),
+                   "sortByKey() sorted by key", size, distribution );
+
+    for ( std::size_t k : SELECTION_COUNTS )
+    {
+        std::vector<int> smallest{ PmergeMe::smallest( input, k ) };
+        checker.check( std::equal( smallest.begin(), smallest.end(), expected.begin(),
+                                   expected.begin() + static_cast<std::ptrdiff_t>( std::min( k, size ) ) ),
+                       "smallest( " + std::to_string( k ) + " )", size, distribution );
+        checker.check( PmergeMe::comparisons() <= PmergeMe::selectionBound( size, k ),
+                       "smallest( " + std::to_string( k ) + " ) comparisons within selectionBound()", size,
+                       distribution );
+    }
+}
+
+// The allocation-free sorts of std::array, for every size they take
+template <std::size_t... Sizes>
+void checkArrays( Checker& checker, Distribution distribution, std::mt19937& rng, std::index_sequence<Sizes...> )
+{
+    auto check_array{ [&]( auto size_constant ) {
+        constexpr std::size_t N{ decltype( size_constant )::value };
+        std::vector<int>      input{ generateInput( N, distribution, rng ) };
+        std::array<int, N>    array{};
+        std::copy( input.begin(), input.end(), array.begin() );
+        std::sort( input.begin(), input.end() );
+
+        PmergeMe::sort( array );
+        checker.check( std::equal( array.begin(), array.end(), input.begin(), input.end() ), "std::array sorted", N,
+                       distribution );
+        checker.check( PmergeMe::comparisons() <= PmergeMe::comparisonBound( N ),
+                       "std::array comparisons within F(n)", N, distribution );
+    } };
+    ( check_array( std::integral_constant<std::size_t, Sizes + 1>{} ), ... );
+}
+
+// Sorts on several threads at once: each thread must read the count of its own sort, the same as when it runs
+// alone (Ford-Johnson makes the same comparisons on the same input)
+void checkThreads( Checker& checker, std::mt19937& rng )
+{
+    constexpr std::size_t thread_count{ 4 };
+
+    std::vector<std::vector<int>> inputs;
+    std::vector<std::size_t>      expected( thread_count );
+    for ( std::size_t t{ 0 }; t < thread_count; ++t )
+    {
+        inputs.push_back( generateInput( 5'000 + 1'000 * t, Distribution::Random, rng ) );
+        std::vector<int> vec{ inputs.back() };
+        PmergeMe::sort( vec );
+        expected[t] = PmergeMe::comparisons();
+    }
+
+    std::vector<std::size_t> counted( thread_count );
+    std::vector<std::thread> threads;
+    for ( std::size_t t{ 0 }; t < thread_count; ++t )
+        threads.emplace_back( [&, t]() {
+            for ( int repeat{ 0 }; repeat < 20; ++repeat )
+            {
+                std::vector<int> vec{ inputs[t] };
+                PmergeMe::sort( vec );
+                counted[t] = PmergeMe::comparisons();
+            }
+        } );
+    for ( auto& thread : threads )
+        thread.join();
+
+    for ( std::size_t t{ 0 }; t < thread_count; ++t )
+        checker.check( counted[t] == expected[t], "comparisons() of the sort on the same thread", inputs[t].size(),
+                       Distribution::Random );
+}
+
+// A temporary file holding text, in $TMPDIR (or /tmp)
+std::string writeTemporaryFile( const std::string& text )
+{
+    const char* directory{ std::getenv( "TMPDIR" ) };
+    std::string path{ std::string{ directory && *directory ? directory : "/tmp" } + "/PmergeMe_test.XXXXXX" };
+    int         fd{ mkstemp( path.data() ) };
+    if ( fd < 0 )
+        throw std::runtime_error( "Could not create a temporary file" );
+
+    OutputBuffer out{ fd };
+    out << text;
+    out.flush();
+    close( fd );
+    return path;
+}
+
+// The whitespace-separated numbers of parseNumbers(): a leading '+' is accepted, negative numbers are not, and a
+// number that reaches the end of a block is left for the next one
+void checkParsing( Checker& checker )
+{
+    std::string      signs{ "+5 7 +12" };
+    std::vector<int> numbers;
+    parseNumbers( signs.data(), signs.data() + signs.size(), true, numbers );
+    checker.check( numbers == std::vector<int>{ 5, 7, 12 }, "parseNumbers() with '+'", signs.size(),
+                   Distribution::Random );
+
+    std::string negative{ "3 -1" };
+    bool        rejected{ false };
+    try
+    {
+        parseNumbers( negative.data(), negative.data() + negative.size(), true, numbers );
+    }
+    catch ( const PmergeMe::InvalidArgument& )
+    {
+        rejected = true;
+    }
+    checker.check( rejected, "parseNumbers() rejects negative numbers", negative.size(), Distribution::Random );
+
+    std::string cut{ "12 34" };
+    numbers.clear();
+    const char* rest{ parseNumbers( cut.data(), cut.data() + cut.size(), false, numbers ) };
+    checker.check( numbers == std::vector<int>{ 12 } && rest == cut.data() + 3,
+                   "parseNumbers() leaves a number cut by the end of the block", cut.size(), Distribution::Random );
+}
+
+// Text of size random numbers (with duplicates), with a number cut by the end of the first block read
+std::string blockBoundaryText( std::size_t size, std::mt19937& rng, std::vector<int>& numbers )
+{
+    std::uniform_int_distribution<int> value{ 0, 1'000'000 };
+    std::string                        text;
+    numbers.clear();
+    while ( numbers.size() < size )
+    {
+        if ( text.size() < READ_BLOCK_SIZE && text.size() + 20 >= READ_BLOCK_SIZE )
+        {
+            text.append( READ_BLOCK_SIZE - 3 - text.size(), ' ' );
+            numbers.push_back( 1'234'567 );
+        }
+        else
+            numbers.push_back( value( rng ) );
+        text += std::to_string( numbers.back() ) + ' ';
+    }
+    return text;
+}
+
+// readNumbers() maps a file, and reads the standard input in blocks
+void checkReading( Checker& checker, const std::string& path, const std::vector<int>& numbers )
+{
+    checker.check( PmergeMe::readNumbers( path ) == numbers, "readNumbers() of a file", numbers.size(),
+                   Distribution::Random );
+
+    int saved_stdin{ dup( STDIN_FILENO ) };
+    int fd{ open( path.c_str(), O_RDONLY ) };
+    dup2( fd, STDIN_FILENO );
+    close( fd );
+    std::vector<int> from_stdin{ PmergeMe::readNumbers( "-" ) };
+    dup2( saved_stdin, STDIN_FILENO );
+    close( saved_stdin );
+    checker.check( from_stdin == numbers, "readNumbers() of the standard input", numbers.size(),
+                   Distribution::Random );
+}
+
+// The sorter takes 4 MiB for its I/O and at least 1 MiB for its chunk on top of what the process already holds:
+// with the least it accepts, chunks are small and there are more runs than it can read at once, so some of them
+// are first merged into longer runs
+void checkExternalSort( Checker& checker, const std::string& path, const std::vector<int>& numbers )
+{
+    constexpr std::size_t least_above_resident{ ( 5 << 20 ) + ( 1 << 18 ) };
+
+    std::vector<int> expected{ numbers };
+    std::sort( expected.begin(), expected.end() );
+
+    rusage usage{};
+    getrusage( RUSAGE_SELF, &usage );
+    std::size_t  resident{ static_cast<std::size_t>( usage.ru_maxrss ) << 10 };
+    ExternalSort sorter{ std::max( ExternalSort::MIN_MEMORY, resident + least_above_resident ) };
+    sorter.sortFile( path );
+
+    std::string output_path{ writeTemporaryFile( "" ) };
+    int         fd{ open( output_path.c_str(), O_RDWR ) };
+    unlink( output_path.c_str() );
+    {
+        OutputBuffer out{ fd };
+        sorter.merge( out, true );
+        out.flush();
+    }
+    std::vector<int> sorted( numbers.size() + 1 );
+    ssize_t          got{ pread( fd, sorted.data(), sorted.size() * sizeof( int ), 0 ) };
+    close( fd );
+    sorted.resize( got < 0 ? 0 : static_cast<std::size_t>( got ) / sizeof( int ) );
+
+    checker.check( sorter.runCount() > 1, "ExternalSort spills runs", numbers.size(), Distribution::Random );
+    checker.check( sorter.size() == numbers.size() && sorted == expected, "ExternalSort sorted", numbers.size(),
+                   Distribution::Random );
+}
+
+} // namespace
+
+int main()
+{
+    const Distribution distributions[]{ Distribution::Random, Distribution::Duplicates, Distribution::Sorted,
+                                        Distribution::Reversed, Distribution::Signed };
+
+    Checker          checker;
+    std::mt19937     rng{ 42 };
+    WorkStealingPool pool{ POOL_THREADS };
+    for ( auto distribution : distributions )
+    {
+        for ( std::size_t size{ 0 }; size <= MAX_EVERY_SIZE; ++size )
+            checkSize( checker, generateInput( size, distribution, rng ), distribution, pool );
+        for ( std::size_t size : LARGE_SIZES )
+            checkSize( checker, generateInput( size, distribution, rng ), distribution, pool );
+        checkArrays( checker, distribution, rng, std::make_index_sequence<PmergeMe::FIXED_SORT_MAX>{} );
+    }
+    checkThreads( checker, rng );
+
+    checkParsing( checker );
+    std::vector<int> numbers;
+    std::string      path{ writeTemporaryFile( blockBoundaryText( EXTERNAL_SIZE, rng, numbers ) ) };
+    checkReading( checker, path, numbers );
+    checkExternalSort( checker, path, numbers );
+    unlink( path.c_str() );
+
+    return checker.report();
+}